@@ -126,7 +126,9 @@ namespace mhg {
             _offset = _winSize * 0.5f;
             while (!WindowShouldClose() && _drawing) {
                 _draw();
+                _mhg._lock.lock();
                 _update();
+                _mhg._lock.unlock();
             }
             CloseWindow();
             _drawing = false;
@@ -196,6 +198,12 @@ namespace mhg {
     }
 
     void DrawerImpl::_stopEditing() {
+        // A link may not take the style of another link on one of its edges, so such an edit is
+        // undone as if it was cancelled.
+        if (_editingEdgeLink && !_mhg.restyle(_editingEdgeLink->style)) {
+            _editingEdgeLink->style->label = _labelPriorToEdit;
+            _editingEdgeLink->style->color = _colorPriorToEdit;
+        }
         _mhg.noticeAction({.type = _editingNode ? MHGactionType::NODE : MHGactionType::EDGE, .change = true, .n = _editingNode, .els = _editingEdgeLink ? _editingEdgeLink->style : nullptr, 
             .prvLabel = _labelPriorToEdit, .curLabel = _editingNode ? _editingNode->p.label : _editingEdgeLink->style->label,
             .prvColor = _colorPriorToEdit, .curColor = _editingNode ? _editingNode->p.color : _editingEdgeLink->style->color});
@@ -212,11 +220,12 @@ namespace mhg {
     }
 
     NodePtr DrawerImpl::_makeHyperAndMoveToMpos(EdgePtr edge, Vector2 pos) {
+        _mhg.beginBatch();
         auto hyperNode = _mhg.makeEdgeHyper(edge);
-        if (_mhg._historyRecording) _mhg._histIt-=2;                    
-        auto o = hyperNode->hg->parent ? hyperNode->hg->parent->dp.posCache : _offset;
+        auto o = hyperNode->hg->parent ? hyperNode->hg->parent->posCache() : _offset;
         _mhg.moveNode(hyperNode, Vector2Zero(), (pos - o) / (hyperNode->hg->scale() * _scale));
         _dropNode(hyperNode, pos);
+        _mhg.commit();
         return hyperNode;
     }
 
@@ -234,8 +243,8 @@ namespace mhg {
                 dropHG->self = dropHG;
             }
             _mhg.transferNode(dropHG, node);
-            auto o = (dropHG == _mhg._root) ? _offset : dropNode->dp.posCache;
-            node->dp.pos = (pos - o) / (dropHG->scale() * _scale);
+            auto o = (dropHG == _mhg._root) ? _offset : dropNode->posCache();
+            node->pos() = (pos - o) / (dropHG->scale() * _scale);
             auto selectedNodes = _selectedNodes;
             for (auto& sn : selectedNodes)
                 if (sn.first->content && _selectedNodes.count(node) && node->hg->isChildOf(sn.first->content))
@@ -255,19 +264,17 @@ namespace mhg {
 
     void DrawerImpl::_startMovingSelection() {
         for (auto& n : _selectedNodes) {
-            auto pos = (_scale * n.first->hg->scale() * n.first->dp.pos + _offset);
-            n.second.first = n.first->dp.pos;
+            auto pos = (_scale * n.first->hg->scale() * n.first->pos() + _offset);
+            n.second.first = n.first->pos();
             n.second.second = pos - GetMousePosition();
         }
     }
 
     void DrawerImpl::_endMovingSelection() {
-        int c = 0;
-        for (auto& n : _selectedNodes) {
-            _mhg.moveNode(n.first, n.second.first, n.first->dp.pos);
-            if (_mhg._historyRecording && c != _selectedNodes.size() - 1) _mhg._histIt-=2;
-            c++;
-        }
+        _mhg.beginBatch();
+        for (auto& n : _selectedNodes)
+            _mhg.moveNode(n.first, n.second.first, n.first->pos());
+        _mhg.commit();
     }
 
     void DrawerImpl::_grabOrSelectNode(NodePtr node) {
@@ -275,8 +282,8 @@ namespace mhg {
         bool selecting = (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_LEFT_SHIFT));
         _grabbedNode = node;
         _grabScale = _scale;
-        _grabbedInitPos = node->dp.pos;
-        _grabOff = (_scale * node->hg->scale() * node->dp.pos + _offset) - mpos;
+        _grabbedInitPos = node->pos();
+        _grabOff = (_scale * node->hg->scale() * node->pos() + _offset) - mpos;
         if (!selecting && !_selectedNodes.count(node))
             _selectedNodes.clear();                
         _startMovingSelection();
@@ -287,24 +294,24 @@ namespace mhg {
             for (auto& sn : selectedNodes)
                 if (sn.first->content && _grabbedNode->hg->isChildOf(sn.first->content)) 
                     _selectedNodes.erase(sn.first);
-            auto pos = (_scale * _grabbedNode->hg->scale() * _grabbedNode->dp.pos + _offset);
+            auto pos = (_scale * _grabbedNode->hg->scale() * _grabbedNode->pos() + _offset);
             _selectedNodes[_grabbedNode] = {_grabbedInitPos, pos - mpos};
         }
     }
 
     void DrawerImpl::_ungrabNode() {
+        _mhg.beginBatch();
         auto selectedNodes = _selectedNodes;
-        for (auto& n : selectedNodes) {
-            _mhg.moveNode(n.first, n.second.first, n.first->dp.pos);
-            if (_mhg._historyRecording) _mhg._histIt-=2;
-        }
+        for (auto& n : selectedNodes)
+            _mhg.moveNode(n.first, n.second.first, n.first->pos());
         std::set<NodePtr> exceptSelected;
         for (auto& sn : _selectedNodes)
             exceptSelected.insert(sn.first);
         for (auto& n : selectedNodes)
             if (!n.first->via)
-                _dropNode(n.first, n.first->dp.posCache, exceptSelected);
+                _dropNode(n.first, n.first->posCache(), exceptSelected);
         _endMovingSelection();
+        _mhg.commit();
         _grabbedNode = nullptr;
     }
 
@@ -357,7 +364,7 @@ namespace mhg {
         auto node = _mhg.addNode("", RED, _hoverNode);
         node->hyper = IsKeyDown(KEY_LEFT_SHIFT);
         auto hg = _hoverNode ? _hoverNode->content : _mhg._root;
-        auto o = _hoverNode ? _hoverNode->dp.posCache : _offset;
+        auto o = _hoverNode ? _hoverNode->posCache() : _offset;
         _mhg.moveNode(node, Vector2Zero(), (GetMousePosition() - o) / (hg->scale() * _scale));
     }
 
@@ -373,12 +380,12 @@ namespace mhg {
 
     void DrawerImpl::_addEdge() {
         if ((_addEdgeFromNode || _addEdgeFromEdge) && (_addEdgeToNode || _addEdgeToEdge)) {
+            _mhg.beginBatch();
             auto from = _addEdgeFromNode ? _addEdgeFromNode : _makeHyperAndMoveToMpos(_addEdgeFromEdge, _addEdgeFromMpos);
-            if (_mhg._historyRecording && !_addEdgeFromNode) _mhg._histIt-=2;
             auto to = _addEdgeToNode ? _addEdgeToNode : _makeHyperAndMoveToMpos(_addEdgeToEdge, GetMousePosition());
-            if (_mhg._historyRecording && !_addEdgeToNode) _mhg._histIt-=2;
             auto style = (!IsKeyDown(KEY_LEFT_SHIFT) && _lastLinkStyle) ? _lastLinkStyle : EdgeLinkStyle::create(COLORS[rand() % COLORS.size()]);
             _mhg.addEdge(style, from, to);
+            _mhg.commit();
             _lastLinkStyle = style;
         }
         _addEdgeFromNode = nullptr;
@@ -389,10 +396,10 @@ namespace mhg {
 
     void DrawerImpl::_deleteSelection() {
         if (_selectedNodes.size()) {
-            for (auto& sn : _selectedNodes) {                   
+            _mhg.beginBatch();
+            for (auto& sn : _selectedNodes)
                 _mhg.removeNode(sn.first);
-                if (_mhg._historyRecording) _mhg._histIt-=2;
-            }
+            _mhg.commit();
             _selectedNodes.clear();
         } else {
             if (_hoverEdgeLink) {
@@ -413,12 +420,13 @@ namespace mhg {
         for (auto& sn : _selectedNodes)
             selected.insert(sn.first);
         _selectedNodes.clear();
+        _mhg.beginBatch();
         auto clones = _mhg.cloneNodes(selected);
         for (auto& c : clones) {
             _selectedNodes[c] = {Vector2Zero(), Vector2Zero()};
-            _mhg.moveNode(c, Vector2Zero(), c->dp.pos + Vector2{30.0f, 30.0f} / c->hg->scale());
-            if (_mhg._historyRecording && _selectedNodes.size() < clones.size()) _mhg._histIt-=2;
+            _mhg.moveNode(c, Vector2Zero(), c->pos() + Vector2{30.0f, 30.0f} / c->hg->scale());
         }
+        _mhg.commit();
     }
 
     void DrawerImpl::_scaleSelection() {
@@ -429,12 +437,12 @@ namespace mhg {
                 _startMovingSelection();
             Vector2 avg = Vector2Zero();
             for (auto& sn : _selectedNodes)
-                avg += sn.first->dp.posCache;
+                avg += sn.first->posCache();
             Vector2 center = avg / float(_selectedNodes.size());
             for (auto& sn : _selectedNodes) {
-                auto newpospix = center + (sn.first->dp.posCache - center) * (newScale / _scale);
-                auto pos = (_scale * sn.first->hg->scale() * sn.first->dp.pos + _offset);
-                sn.first->dp.pos = (newpospix - _offset + _curOffset + (pos - sn.first->dp.posCache)) / (sn.first->hg->scale() * _scale);
+                auto newpospix = center + (sn.first->posCache() - center) * (newScale / _scale);
+                auto pos = (_scale * sn.first->hg->scale() * sn.first->pos() + _offset);
+                sn.first->pos() = (newpospix - _offset + _curOffset + (pos - sn.first->posCache())) / (sn.first->hg->scale() * _scale);
             }
             _recentlyScaled = true;
             _lastScaleTs = GetTime();
@@ -446,7 +454,7 @@ namespace mhg {
         for (auto& sn : _selectedNodes)
             exceptSelected.insert(sn.first);
         for (auto& sn : _selectedNodes) {
-            sn.first->dp.overNode = _mhg.getNodeAt(sn.first->dp.posCache, exceptSelected);
+            sn.first->dp.overNode = _mhg.getNodeAt(sn.first->posCache(), exceptSelected);
             if (sn.first->dp.overNode)
                 if (!sn.first->hg->parent || sn.first->dp.overNode != sn.first->hg->parent)
                     sn.first->dp.overNode->dp.tmpDrawableNodes++;
@@ -454,8 +462,9 @@ namespace mhg {
                 sn.first->hg->parent->dp.tmpDrawableNodes--;
             sn.first->dp.overRoot = !bool(sn.first->dp.overNode);
         }
+        _mhg.invalidateScale();
         for (auto& sn : _selectedNodes)
-            sn.first->dp.pos = (GetMousePosition() - _offset + _curOffset + sn.second.second * (_scale / _grabScale)) / (sn.first->hg->scale() * _scale);
+            sn.first->pos() = (GetMousePosition() - _offset + _curOffset + sn.second.second * (_scale / _grabScale)) / (sn.first->hg->scale() * _scale);
     }
 
     void DrawerImpl::_checkDoneScaling() {
@@ -578,6 +587,14 @@ namespace mhg {
             // RECENTER
             if (IsKeyPressed(KEY_C))
                 recenter();
+
+            // PHYSICS
+            if (IsKeyPressed(KEY_P))
+                _mhg.setPhysicsEnabled(!_mhg.isPhysicsEnabled());
+
+            // INCREMENTAL LAYOUT
+            if (IsKeyPressed(KEY_L))
+                _mhg.setIncrementalLayout(!_mhg.isIncrementalLayout());
             
             // FULLSCREEN
             if (IsKeyPressed(KEY_F) || IsKeyPressed(KEY_F11))
@@ -594,22 +611,22 @@ namespace mhg {
     }
 
     void DrawerImpl::_drawEdgeAdding() {
-        auto from = _addEdgeFromNode ? _addEdgeFromNode->dp.posCache : _addEdgeFromMpos;
+        auto from = _addEdgeFromNode ? _addEdgeFromNode->posCache() : _addEdgeFromMpos;
         auto to = GetMousePosition();
         DrawLineEx(from, to, EDGE_THICK, WHITE);
     }
 
     void DrawerImpl::_updateHighlights() {
         if (_hoverEdgeLink) _hoverEdgeLink->highlight = HIGHLIGHT_INTENSITY;
-        if (_hoverNode) _hoverNode->dp.highlight = HIGHLIGHT_INTENSITY;
-        if (_addEdgeFromNode) _addEdgeFromNode->dp.highlight = HIGHLIGHT_INTENSITY_2;
+        if (_hoverNode) _hoverNode->highlight() = HIGHLIGHT_INTENSITY;
+        if (_addEdgeFromNode) _addEdgeFromNode->highlight() = HIGHLIGHT_INTENSITY_2;
         if (_addEdgeFromEdge) _addEdgeFromEdge->dp.highlight = HIGHLIGHT_INTENSITY_2;
-        if (_addEdgeToNode) _addEdgeToNode->dp.highlight = HIGHLIGHT_INTENSITY_2;
+        if (_addEdgeToNode) _addEdgeToNode->highlight() = HIGHLIGHT_INTENSITY_2;
         if (_addEdgeToEdge) _addEdgeToEdge->dp.highlight = HIGHLIGHT_INTENSITY_2;
         for (auto& sn : _selectedNodes)
-            sn.first->dp.highlight = HIGHLIGHT_INTENSITY_2;
+            sn.first->highlight() = HIGHLIGHT_INTENSITY_2;
         for (auto& sn : _selectedNodesTmp)
-            sn.first->dp.highlight = HIGHLIGHT_INTENSITY_2;
+            sn.first->highlight() = HIGHLIGHT_INTENSITY_2;
     }
 
     void DrawerImpl::_draw() {
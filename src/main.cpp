@@ -18,7 +18,6 @@ int main(int argc, char *argv[]) {
     auto drawer = mhg::Drawer::create(mhg, {W_W, W_H}, "META HYPER GRAPH");
 
 	while (drawer->isDrawing()) {
-		//mhg.doPhysics();
 		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		if (!drawer->isEditing() && IsKeyPressed(KEY_R)) {
 			mhg.init();
@@ -5,8 +5,6 @@
 
 #include <memory>
 
-#define RAND_FLOAT static_cast <float> (rand()) / (static_cast <float> (RAND_MAX) + 1.0f)
-
 #include <Eigen/Core>
 
 namespace mhg {
@@ -19,4 +17,14 @@ namespace mhg {
 
     typedef Eigen::Matrix<float, -1,  1> Vector;
     typedef Eigen::Matrix<float, -1, -1> Matrix;
+
+    enum class LayoutMode { DEFAULT, KAMADA_KAWAI, STRESS_MAJORIZATION, MULTILEVEL };
+
+    struct LayoutStats {
+        int iterations = 0;
+        // Largest per-node gradient (Kamada-Kawai) or net force on the finest level (multilevel),
+        // or the total stress (stress majorization).
+        float energy = 0.0f;
+        double seconds = 0.0;
+    };
 }
\ No newline at end of file
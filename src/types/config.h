@@ -17,4 +17,34 @@
 #define SPRING_STR 0.05f
 #define LINKS_DENSITY 3.0f
 
-#define SCALING_EVENT_TIMEOUT 0.5
\ No newline at end of file
+#define SCALING_EVENT_TIMEOUT 0.5
+
+#define LAYOUT_PARALLEL_MIN_NODES 256
+#define KK_THRESH 1e-2f
+#define KK_INNER_THRESH 1.0f
+#define KK_MIN_ITS 1000
+#define KK_MAX_ITS 6000
+#define KK_ITS_PER_NODE 10
+#define KK_MAX_INNER_ITS 5
+#define STRESS_MAX_ITS 300
+#define STRESS_EPS 1e-4f
+#define DENSE_LAYOUT_MAX_NODES 4096
+#define MULTILEVEL_COARSEST 50
+#define MULTILEVEL_MIN_SHRINK 0.9f
+#define MULTILEVEL_ITS 100
+#define MULTILEVEL_COARSEST_ITS 300
+#define MULTILEVEL_COOLING 0.95f
+#define MULTILEVEL_SPRING_GROWTH 1.3f
+#define MULTILEVEL_JITTER 0.1f
+#define RELAYOUT_HOPS 2
+#define RELAYOUT_MAX_ITS 50
+
+#define PHYSICS_TICK_RATE 60
+#define PHYSICS_STEP 0.05f
+#define PHYSICS_MAX_STEP 10.0f
+#define PHYSICS_THETA 0.8f
+#define PHYSICS_GRAVITY 0.05f
+#define PHYSICS_VIA_CHARGE 0.25f
+#define PHYSICS_VIA_STIFFNESS 1.0f
+
+#define HISTORY_MAX_BYTES (16u << 20)
\ No newline at end of file
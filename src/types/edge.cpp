@@ -3,24 +3,33 @@
 #include "hypergraph.h"
 #include "raylib.h"
 #include "raymath.h"
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <map>
 #include <memory>
 #include <string>
 
 namespace mhg {
 
     bool operator==(const EdgeLinkPtr& lhs, const EdgeLinkPtr& rhs) {
-        return lhs->style->color.r == rhs->style->color.r && 
-               lhs->style->color.g == rhs->style->color.g && 
-               lhs->style->color.b == rhs->style->color.b && 
-               lhs->style->color.a == rhs->style->color.a && 
-               lhs->style->label == rhs->style->label; 
+        return lhs->style->id == rhs->style->id;
     }
     bool operator<(const EdgeLinkPtr& lhs, const EdgeLinkPtr& rhs) {
-        size_t c1 = col2num(lhs->style->color);
-        size_t c2 = col2num(rhs->style->color);
-        return (lhs->style->label == rhs->style->label && c1 < c2) || (lhs->style->label < rhs->style->label);
+        return lhs->style->id < rhs->style->id;
+    }
+
+    EdgeLinkPtr EdgeLink::create(EdgePtr edge, EdgeLinkStylePtr style, EdgeLinkParams params) {
+        auto arena = (edge && edge->hg) ? edge->hg->pmhg.arena() : nullptr;
+        return std::allocate_shared<EdgeLink>(ArenaAllocator<EdgeLink>(arena), edge, style, params);
+    }
+
+    EdgeLinkPtr EdgeLink::create(EdgeLinkPtr el) {
+        return create(el->edge, el->style, el->params);
+    }
+
+    EdgePtr Edge::create(HyperGraphPtr hg, size_t idx, NodePtr from, NodePtr via, NodePtr to) {
+        return std::allocate_shared<Edge>(ArenaAllocator<Edge>(hg ? hg->pmhg.arena() : nullptr), hg, idx, from, via, to);
     }
 
     Texture2D Edge::getArrowHead() {
@@ -40,7 +49,7 @@ namespace mhg {
     }
 
     void Edge::reposition() {
-        via->dp.pos = 0.5f * (from->dp.pos + to->dp.pos);
+        via->pos() = 0.5f * (from->pos() + to->pos());
     }
 
     bool Edge::similar(EdgePtr edge) {
@@ -95,12 +104,33 @@ namespace mhg {
         bool fromSameHG = (from->hg == hg);
         bool toSameHG = (to->hg == hg);
         bool notSame = !fromSameHG || !toSameHG;
-
-        Vector2 pt0 = fromSameHG ? (origin + ls * from->dp.pos + offset) : from->dp.posCache;
-        Vector2 pt2 = toSameHG ? (origin + ls * to->dp.pos + offset) : to->dp.posCache;
-        Vector2 pt1 = (notSame || !physics) ? (0.5f * (pt0 + pt2)) : (origin + ls * via->dp.pos + offset);
+        // An end inside a culled level was not predrawn this frame.
+        if (!fromSameHG && from->hg->isCulled())
+            from->updateCache(from->hg->origin() * scale, offset, scale);
+        if (!toSameHG && to->hg->isCulled())
+            to->updateCache(to->hg->origin() * scale, offset, scale);
+
+        Vector2 pt0 = fromSameHG ? (origin + ls * from->pos() + offset) : from->posCache();
+        Vector2 pt2 = toSameHG ? (origin + ls * to->pos() + offset) : to->posCache();
+        Vector2 pt1 = (notSame || !physics) ? (0.5f * (pt0 + pt2)) : (origin + ls * via->pos() + offset);
         Vector2 pt0m, pt1m, pt2m;
 
+        // The curves stay inside the control triangle, give or take the link spread, thickness
+        // and arrow heads. Labels are placed more freely, so an edge showing one is never culled.
+        bool labeled = false;
+        for (auto& l : links)
+            labeled |= (l->editing || l->highlight);
+        if (!labeled) {
+            auto arrow = Edge::getArrowHead();
+            float pad = std::max(from->rCache(), to->rCache()) + EDGE_THICK + ARROW_SZ * Vector2Length({(float)arrow.width, (float)arrow.height});
+            Vector2 lo = {std::min({pt0.x, pt1.x, pt2.x}) - pad, std::min({pt0.y, pt1.y, pt2.y}) - pad};
+            Vector2 hi = {std::max({pt0.x, pt1.x, pt2.x}) + pad, std::max({pt0.y, pt1.y, pt2.y}) + pad};
+            if (!isOnScreen(lo, hi)) {
+                dp.highlight = 0.0f;
+                return nullptr;
+            }
+        }
+
         Vector2 apos; float angle; float t1; 
         findArrowPositionBezier(pt0, pt1, pt2, false, minLvlNodeScale, apos, angle, t1);
         Vector2 apos2; float angle2; float t2;
@@ -122,8 +152,8 @@ namespace mhg {
 
        for (auto& l : links) {
             if (links.size() > 1) {
-                pt0m = pt0 + from->dp.rCache * Vector2{ cos(a1), sin(a1) };
-                pt2m = pt2 + to->dp.rCache * Vector2{ cos(a2), sin(a2) };
+                pt0m = pt0 + from->rCache() * Vector2{ cos(a1), sin(a1) };
+                pt2m = pt2 + to->rCache() * Vector2{ cos(a2), sin(a2) };
                 pt1m = pt1 + (pt0m - pt0 + pt2m - pt2) * 0.5f;
 
                 a1 += aFromStep;
@@ -152,13 +182,13 @@ namespace mhg {
                     auto pt = getPoint(pt0m, pt1m, pt2m, 0.0 - 0.01);
                     float ang = atan2(apos2.y - pt.y, apos2.x - pt.x);
                     Vector2 off = Vector2Rotate(Vector2{(float)arrow.width, (float)arrow.height} * 0.5f, ang);
-                    DrawTextureEx(arrow, apos - off * arscl, 180.0f * ang / PI, arscl, ColorBrightness(l->style->color, std::max(l->highlight, dp.highlight)));
+                    hg->pmhg.edgeBatch().texture(arrow, apos - off * arscl, 180.0f * ang / PI, arscl, ColorBrightness(l->style->color, std::max(l->highlight, dp.highlight)));
                 }
                 if (l->params.backward) {
                     auto pt = getPoint(pt0m, pt1m, pt2m, 1.0 + 0.01);
                     float ang = atan2(apos2.y - pt.y, apos2.x - pt.x);
                     Vector2 off = Vector2Rotate(Vector2{(float)arrow.width, (float)arrow.height} * 0.5f, ang);
-                    DrawTextureEx(arrow, apos2 - off * arscl, 180.0f * ang / PI, arscl, ColorBrightness(l->style->color, std::max(l->highlight, dp.highlight)));
+                    hg->pmhg.edgeBatch().texture(arrow, apos2 - off * arscl, 180.0f * ang / PI, arscl, ColorBrightness(l->style->color, std::max(l->highlight, dp.highlight)));
                 }
             }
             bool drawLabel = l->editing || l->highlight;
@@ -170,6 +200,7 @@ namespace mhg {
                     if (abs(angle) > PI * 0.5f) angle -= (abs(angle)/angle) * PI;
                     Vector2 pos = (apos + apos2) * 0.5f;
                     Vector2 off = -Vector2Rotate(Vector2{sz.x * 0.5f + EDGE_TXT_SPACING * 1.5f, fntsz * EDGE_TXT_OFFSET }, angle);
+                    hg->pmhg.edgeBatch().flush();
                     DrawTextPro(font, l->style->label.c_str(), pos + off, Vector2Zero(), angle * RAD2DEG, fntsz, EDGE_TXT_SPACING, WHITE);
                 }
             }
@@ -2,6 +2,7 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <list>
 #include <algorithm>
 #include <memory>
@@ -13,16 +14,19 @@
 #include "base.h"
 #include "node.h"
 #include "raylib.h"
-
-#define col2num(color) (256 * 256 * size_t(color.r) + 256 * size_t(color.g) + size_t(color.b))
+#include "../util/small_set.h"
 
 namespace mhg {
 
     struct EdgeLinkStyle;
     typedef std::shared_ptr<EdgeLinkStyle> EdgeLinkStylePtr;
+    // Link sets are ordered by `id`, which MetaHyperGraph::internStyle() gives each (colour, label)
+    // value, so equal styles share it. A style edited in place keeps its old id until
+    // MetaHyperGraph::restyle() is called.
     struct EdgeLinkStyle {
         Color color = RED;
         std::string label = "";
+        uint32_t id = 0;
         static EdgeLinkStylePtr create() {
             return std::make_shared<EdgeLinkStyle>();
         }
@@ -47,16 +51,12 @@ namespace mhg {
         bool editing = false;
         EdgeLink(EdgePtr edge, EdgeLinkStylePtr style, EdgeLinkParams params = {}) : edge(edge), style(style), params(params) 
         { }
-        static EdgeLinkPtr create(EdgePtr edge, EdgeLinkStylePtr style, EdgeLinkParams params = {}) {
-            return std::make_shared<EdgeLink>(edge, style, params);
-        }
-        static EdgeLinkPtr create(EdgeLinkPtr el) {
-            return std::make_shared<EdgeLink>(el->edge, el->style, el->params);
-        }
+        static EdgeLinkPtr create(EdgePtr edge, EdgeLinkStylePtr style, EdgeLinkParams params = {});
+        static EdgeLinkPtr create(EdgeLinkPtr el);
     };
 
     typedef std::list<std::pair<EdgeLinkStylePtr, NodePtr>> EdgeLinksBundle;
-    typedef std::set<EdgeLinkPtr> EdgeLinks;
+    typedef SmallSet<EdgeLinkPtr, 4> EdgeLinks;
 
     bool operator==(const EdgeLinkPtr& lhs, const EdgeLinkPtr& rhs);
     bool operator<(const EdgeLinkPtr& lhs, const EdgeLinkPtr& rhs);
@@ -92,9 +92,7 @@ namespace mhg {
         void reposition();
         EdgeLinkPtr draw(Vector2 origin, Vector2 offset, float s, const Font& font, bool physics, const std::map<NodePtr, std::pair<Vector2, Vector2>>& selectedNodes);
 
-        static EdgePtr create(HyperGraphPtr hg, size_t idx, NodePtr from, NodePtr via, NodePtr to) {
-            return std::make_shared<Edge>(hg, idx, from, via, to);
-        }
+        static EdgePtr create(HyperGraphPtr hg, size_t idx, NodePtr from, NodePtr via, NodePtr to);
     };
 
 }
\ No newline at end of file
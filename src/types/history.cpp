@@ -0,0 +1,203 @@
+#include "history.h"
+#include "hypergraph.h"
+#include "node.h"
+
+#include <bitset>
+
+namespace mhg {
+
+    void History::clear() {
+        for (const auto& en : _entries) {
+            size_t r = en.ref - _refBase;
+            for (uint8_t kind = HG; kind <= ELS; kind <<= 1) {
+                if (!(en.refs & kind))
+                    continue;
+                if (kind == E)
+                    std::static_pointer_cast<Edge>(_refs[r])->links.clear();
+                r++;
+            }
+        }
+        _entries = { _separator() };
+        _refs.clear();
+        _labels.clear();
+        _refBase = 0;
+        _labelBase = 0;
+        _labelBytes = 0;
+        _pos = 1;
+    }
+
+    void History::setLimit(size_t bytes) {
+        _limit = bytes;
+        _dropOldest();
+    }
+
+    size_t History::memoryUsage() const {
+        return _entries.size() * sizeof(Entry) + _refs.size() * sizeof(std::shared_ptr<void>) + _labelBytes;
+    }
+
+    void History::push(const MHGaction& action, bool sep) {
+        _truncate();
+        auto& back = _entries.back();
+        if (action.type == MHGactionType::SEP) {
+            if (back.type != uint8_t(MHGactionType::SEP))
+                _entries.push_back(_separator());
+            _pos = _entries.size();
+            return;
+        }
+
+        // A drag reports every intermediate position; only where it started and ended matter.
+        bool inverse = action.inverse;
+        if (action.type == MHGactionType::MOVE && back.type == uint8_t(MHGactionType::MOVE) &&
+            bool(back.flags & INVERSE) == inverse && (back.refs & N) && _refs.back() == action.n) {
+            back.move.cur = action.cur;
+        } else {
+            Entry en;
+            en.type = uint8_t(action.type);
+            en.flags = uint8_t((inverse ? INVERSE : 0) | (action.change ? CHANGE : 0));
+            en.ref = _refBase + _refs.size();
+            en.label = _labelBase + _labels.size();
+            auto ref = [&](uint8_t kind, std::shared_ptr<void> p) {
+                if (!p)
+                    return;
+                en.refs |= kind;
+                _refs.push_back(std::move(p));
+            };
+            switch (action.type) {
+            case MHGactionType::NODE:
+            case MHGactionType::EDGE:
+                if (action.type == MHGactionType::NODE)
+                    ref(N, action.n);
+                else if (!action.change)
+                    ref(E, action.e);
+                ref(ELS, action.els);
+                if (action.change) {
+                    _labels.push_back(action.prvLabel);
+                    _labels.push_back(action.curLabel);
+                    _labelBytes += action.prvLabel.capacity() + action.curLabel.capacity() + 2 * sizeof(std::string);
+                    en.change = Change{action.prvColor, action.curColor};
+                } else {
+                    en.link = Link{action.elp.weight, action.elp.foreward, action.elp.backward};
+                }
+                break;
+            case MHGactionType::TRANSFER:
+                ref(HG, action.hg);
+                ref(FROM, action.from);
+                ref(N, action.n);
+                break;
+            case MHGactionType::MOVE:
+                ref(N, action.n);
+                en.move = Move{action.prv, action.cur};
+                break;
+            default:
+                ref(N, action.n);
+                break;
+            }
+            _entries.push_back(en);
+        }
+        if (sep)
+            _entries.push_back(_separator());
+        _pos = _entries.size();
+        _dropOldest();
+    }
+
+    MHGaction History::_decode(size_t i) const {
+        const auto& en = _entries[i];
+        MHGaction a{.type = MHGactionType(en.type), .inverse = bool(en.flags & INVERSE), .change = bool(en.flags & CHANGE)};
+        size_t r = en.ref - _refBase;
+        if (en.refs & HG)
+            a.hg = std::static_pointer_cast<HyperGraph>(_refs[r++]);
+        if (en.refs & FROM)
+            a.from = std::static_pointer_cast<HyperGraph>(_refs[r++]);
+        if (en.refs & N)
+            a.n = std::static_pointer_cast<Node>(_refs[r++]);
+        if (en.refs & E)
+            a.e = std::static_pointer_cast<Edge>(_refs[r++]);
+        if (en.refs & ELS)
+            a.els = std::static_pointer_cast<EdgeLinkStyle>(_refs[r++]);
+        if (a.type == MHGactionType::MOVE) {
+            a.prv = en.move.prv;
+            a.cur = en.move.cur;
+        } else if (a.change) {
+            a.prvLabel = _labels[en.label - _labelBase];
+            a.curLabel = _labels[en.label - _labelBase + 1];
+            a.prvColor = en.change.prv;
+            a.curColor = en.change.cur;
+        } else if (a.type == MHGactionType::EDGE) {
+            a.elp = {en.link.weight, en.link.foreward, en.link.backward};
+        }
+        return a;
+    }
+
+    void History::_truncate() {
+        while (_entries.size() > _pos) {
+            const auto& en = _entries.back();
+            for (size_t k = std::bitset<8>(en.refs).count(); k > 0; --k)
+                _refs.pop_back();
+            if (en.flags & CHANGE) {
+                for (int k = 0; k < 2; ++k) {
+                    _labelBytes -= _labels.back().capacity() + sizeof(std::string);
+                    _labels.pop_back();
+                }
+            }
+            _entries.pop_back();
+        }
+    }
+
+    // Drops whole undo steps from the front, never touching the step that would be undone next
+    // or anything that can still be redone.
+    void History::_dropOldest() {
+        while (memoryUsage() > _limit) {
+            size_t next = 1;
+            while (next < _pos && _entries[next].type != uint8_t(MHGactionType::SEP))
+                next++;
+            if (next + 1 >= _pos)
+                break;
+            for (size_t i = 0; i < next; ++i) {
+                const auto& en = _entries.front();
+                for (uint8_t kind = HG; kind <= ELS; kind <<= 1) {
+                    if (!(en.refs & kind))
+                        continue;
+                    _release(kind, std::move(_refs.front()));
+                    _refs.pop_front();
+                    _refBase++;
+                }
+                if (en.flags & CHANGE) {
+                    for (int k = 0; k < 2; ++k) {
+                        _labelBytes -= _labels.front().capacity() + sizeof(std::string);
+                        _labels.pop_front();
+                        _labelBase++;
+                    }
+                }
+                _entries.pop_front();
+            }
+            _pos -= next;
+        }
+    }
+
+    // Removed nodes and edges keep themselves alive through back references. Once the log holds
+    // the last outside reference to one of them, break those cycles so it is actually freed.
+    void History::_release(uint8_t kind, std::shared_ptr<void> ref) {
+        if (kind == E) {
+            auto edge = std::static_pointer_cast<Edge>(ref);
+            ref.reset();
+            long selfRefs = 0;
+            for (const auto& l : edge->links)
+                selfRefs += (l->edge == edge);
+            if (edge.use_count() == 1 + selfRefs)
+                edge->links.clear();
+        } else if (kind == N) {
+            auto node = std::static_pointer_cast<Node>(ref);
+            ref.reset();
+            auto content = node->content;
+            if (content && content->parent == node && node.use_count() == 2) {
+                content->release();
+                content->self = nullptr;
+                content->parent = nullptr;
+                node->content = nullptr;
+                node->eIn.clear();
+                node->eOut.clear();
+            }
+        }
+    }
+
+}
\ No newline at end of file
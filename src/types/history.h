@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "base.h"
+#include "edge.h"
+#include "raylib.h"
+
+namespace mhg {
+
+    enum class MHGactionType { SEP, NODE, EDGE, MOVE, TRANSFER, HYPER };
+    struct MHGaction {
+        MHGactionType type = MHGactionType::SEP;
+        bool inverse = false;
+        bool change = false;
+        HyperGraphPtr hg = nullptr, from = nullptr;
+        NodePtr n = nullptr;
+        EdgePtr e = nullptr;
+        EdgeLinkStylePtr els = nullptr;
+        EdgeLinkParams elp = EdgeLinkParams{};
+        Vector2 prv = {}, cur = {};
+        std::string prvLabel = "", curLabel = "";
+        Color prvColor = {}, curColor = {};
+    };
+
+    // Undo log stored as fixed-size records. Object references and labels live in side queues,
+    // and only the fields an action type uses are kept. Steps are separated by SEP records.
+    // Once the log is over its memory limit, the oldest steps are dropped.
+    class History {
+        public:
+            History() { clear(); }
+
+            void clear();
+            void setLimit(size_t bytes);
+            size_t memoryUsage() const;
+
+            void push(const MHGaction& action, bool sep);
+
+            template<typename F>
+            void undo(F&& apply) {
+                if (_pos <= 1)
+                    return;
+                size_t i = _pos - 1;
+                if (i > 0 && _entries[i].type == uint8_t(MHGactionType::SEP))
+                    i--;
+                while (_entries[i].type != uint8_t(MHGactionType::SEP))
+                    apply(_decode(i--));
+                _pos = i + 1;
+            }
+
+            template<typename F>
+            void redo(F&& apply) {
+                size_t i = _pos;
+                while (i < _entries.size() && _entries[i].type != uint8_t(MHGactionType::SEP))
+                    apply(_decode(i++));
+                _pos = std::min(i + 1, _entries.size());
+            }
+
+        private:
+            enum Ref : uint8_t { HG = 1, FROM = 2, N = 4, E = 8, ELS = 16 };
+            enum Flag : uint8_t { INVERSE = 1, CHANGE = 2 };
+
+            struct Move { Vector2 prv, cur; };
+            struct Link { float weight; bool foreward, backward; };
+            struct Change { Color prv, cur; };
+
+            // Refs and labels are absolute indices into the side queues, in HG..ELS order.
+            struct Entry {
+                uint8_t type = 0;
+                uint8_t flags = 0;
+                uint8_t refs = 0;
+                uint64_t ref = 0;
+                uint64_t label = 0;
+                union {
+                    Move move = {};
+                    Link link;
+                    Change change;
+                };
+            };
+
+            std::deque<Entry> _entries;
+            std::deque<std::shared_ptr<void>> _refs;
+            std::deque<std::string> _labels;
+            uint64_t _refBase = 0;
+            uint64_t _labelBase = 0;
+            size_t _labelBytes = 0;
+            size_t _pos = 1;
+            size_t _limit = HISTORY_MAX_BYTES;
+
+            static Entry _separator() {
+                Entry en;
+                en.type = uint8_t(MHGactionType::SEP);
+                return en;
+            }
+            MHGaction _decode(size_t i) const;
+            void _truncate();
+            void _dropOldest();
+            static void _release(uint8_t kind, std::shared_ptr<void> ref);
+    };
+
+}
\ No newline at end of file
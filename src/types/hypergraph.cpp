@@ -3,6 +3,10 @@
 #include "edge.h"
 #include "node.h"
 #include "raylib.h"
+#include "../util/parallel.h"
+#include "../util/rng.h"
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <iterator>
 #include <memory>
@@ -10,11 +14,50 @@
 namespace mhg {
 
     bool HyperGraph::isChildOf(HyperGraphPtr hg) {
-        if (hg.get() == this)
-            return true;
-        if (!parent)
-            return false;
-        return parent->hg->isChildOf(hg);
+        return hg && hg->lvl <= lvl && _ancestors[hg->lvl] == hg.get();
+    }
+
+    void HyperGraph::_updateHierarchy() {
+        pmhg.invalidateScale();
+        lvl = parent ? (parent->hg->lvl + 1) : 0;
+        if (parent)
+            _ancestors = parent->hg->_ancestors;
+        else
+            _ancestors.clear();
+        _ancestors.push_back(this);
+        for (auto& n : _nodes)
+            if (n.second->content)
+                n.second->content->_updateHierarchy();
+    }
+
+    // Whether some edge holding `style` has another link whose style already has `id`.
+    bool HyperGraph::hasLinkClash(const EdgeLinkStylePtr& style, uint32_t id) {
+        for (auto& e : _edges) {
+            auto& links = e.second->links;
+            if (std::any_of(links.begin(), links.end(), [&](const EdgeLinkPtr& l) { return l->style == style; }) &&
+                std::any_of(links.begin(), links.end(), [&](const EdgeLinkPtr& l) { return l->style != style && l->style->id == id; }))
+                return true;
+        }
+        for (auto& n : _nodes)
+            if (n.second->content && n.second->content->hasLinkClash(style, id))
+                return true;
+        return false;
+    }
+
+    // Re-sorts the link sets holding `style` under its new id.
+    void HyperGraph::restyle(const EdgeLinkStylePtr& style) {
+        for (auto& e : _edges) {
+            auto& links = e.second->links;
+            if (std::none_of(links.begin(), links.end(), [&](const EdgeLinkPtr& l) { return l->style == style; }))
+                continue;
+            std::vector<EdgeLinkPtr> relinked(links.begin(), links.end());
+            links.clear();
+            for (auto& l : relinked)
+                links.insert(l);
+        }
+        for (auto& n : _nodes)
+            if (n.second->content)
+                n.second->content->restyle(style);
     }
 
     void HyperGraph::clear() {
@@ -23,10 +66,46 @@ namespace mhg {
             removeNode(n.second);
         _nodes.clear();
         _edges.clear();
+        _edgeIndex.clear();
+        _dist.resize(0, 0);
+        _distKeys.clear();
+        _pendingEdges.clear();
+        _droppedNodes.clear();
+        _adj = {};
+        _version++;
     }
 
-    void HyperGraph::removeOuterEdges(HyperGraphPtr hg) {
+    void HyperGraph::release() {
         for (auto& n : _nodes) {
+            auto& node = n.second;
+            if (node->content) {
+                node->content->release();
+                node->content->self = nullptr;
+                node->content->parent = nullptr;
+            }
+            node->eIn.clear();
+            node->eOut.clear();
+            node->dp.overNode = nullptr;
+        }
+        for (auto& e : _edges)
+            e.second->links.clear();
+        _nodes.clear();
+        _edges.clear();
+        _edgeIndex.clear();
+        _dist.resize(0, 0);
+        _distKeys.clear();
+        _pendingEdges.clear();
+        _droppedNodes.clear();
+        _adj = {};
+        _dirtyNodes.clear();
+        _newNodes.clear();
+        _version++;
+        dp = {};
+    }
+
+    void HyperGraph::removeOuterEdges(HyperGraphPtr hg) {
+        auto nodes = _nodes;
+        for (auto& n : nodes) {
             if (n.second->content)
                 n.second->content->removeOuterEdges(hg);
             auto eIn = n.second->eIn;
@@ -60,15 +139,47 @@ namespace mhg {
             if (e->hg != maxLvlHg)
                 maxLvlHg->transferEdge(e);
         }
-        if (node->content)
-            for (auto& n : node->content->_nodes)
+        if (node->content) {
+            auto nodes = node->content->_nodes;
+            for (auto& n : nodes)
                 node->content->checkForTransferEdges(n.second);
+        }
     }
 
     float HyperGraph::coeff() {
         return 1.0f / (dp.nDrawableNodes + 1);
     }
     
+    size_t NodeStates::acquire() {
+        if (!freeSlots.empty()) {
+            size_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            pos[slot] = Vector2Zero();
+            highlight[slot] = 0.0f;
+            return slot;
+        }
+        pos.push_back(Vector2Zero());
+        posCache.push_back(Vector2Zero());
+        rCache.push_back(0.0f);
+        rCacheStable.push_back(0.0f);
+        scaleCache.push_back(0.0f);
+        highlight.push_back(0.0f);
+        return pos.size() - 1;
+    }
+
+    void NodeStates::release(size_t slot) {
+        freeSlots.push_back(slot);
+    }
+
+    void NodeStates::copy(size_t slot, const NodeStates& from, size_t fromSlot) {
+        pos[slot] = from.pos[fromSlot];
+        posCache[slot] = from.posCache[fromSlot];
+        rCache[slot] = from.rCache[fromSlot];
+        rCacheStable[slot] = from.rCacheStable[fromSlot];
+        scaleCache[slot] = from.scaleCache[fromSlot];
+        highlight[slot] = from.highlight[fromSlot];
+    }
+
     size_t HyperGraph::nodesCount() {
         return _nodes.size();
     }
@@ -76,31 +187,41 @@ namespace mhg {
     float HyperGraph::scale() {
         if (!parent)
             return 1.0f;
+        if (dp._scaleEpoch == pmhg.scaleEpoch())
+            return dp._scaleCache;
         dp._nDrawableNodesCache = dp.nDrawableNodes + (parent ? parent->dp.tmpDrawableNodes : 0);
         bool willDrop = (parent->dp.overNode || parent->dp.overRoot);
-        return (willDrop ? ((parent->dp.overNode ? (parent->dp.overNode->scale()) : 1.0f) * parent->coeff()) : (parent->hg->scale() * coeff()));
+        dp._scaleCache = (willDrop ? ((parent->dp.overNode ? (parent->dp.overNode->scale()) : 1.0f) * parent->coeff()) : (parent->hg->scale() * coeff()));
+        dp._scaleEpoch = pmhg.scaleEpoch();
+        return dp._scaleCache;
     }
 
     NodePtr HyperGraph::addNode(const std::string &label, const Color &color, bool via, bool hyper) {
-        auto node = Node::create(self, _nodes.size() ? (_nodes.rbegin()->first + 1) : 0, NodeParams{label, color}, via, hyper);
+        auto node = Node::create(self, _nodes.nextKey(), NodeParams{label, color}, via, hyper);
         addNode(node);
         return node;
     }
 
     void HyperGraph::addNode(NodePtr node) {
-        node->hg = self;
+        bool moved = (node->hg != self);
+        _adopt(node);
+        if (moved && node->content)
+            node->content->_updateHierarchy();
         if (!node->via && !node->hyper)
             updateScale(1);
         _nodes[node->idx] = node;
+        _noteNodeAdded(node);
     }
 
     NodePtr HyperGraph::cloneNode(NodePtr node) {
-        auto newNode = std::make_shared<Node>(self, _nodes.size() ? (_nodes.rbegin()->first + 1) : 0, node->p, node->via, node->hyper);
+        auto newNode = Node::create(self, _nodes.nextKey(), node->p, node->via, node->hyper);
         newNode->dp = node->dp;
+        states.copy(newNode->slot, node->hg->states, node->slot);
         newNode->content = node->content;
         if (node->content) {
             newNode->content = node->content->clone();
             newNode->content->parent = newNode;
+            newNode->content->_updateHierarchy();
         }
         addNode(newNode);
         return newNode;
@@ -108,14 +229,15 @@ namespace mhg {
     
     void HyperGraph::transferNode(NodePtr node, bool moveEdges) {
         node->hg->removeNode(node, false);        
-        node->hg = self;
+        _adopt(node);
         if (!node->via && !node->hyper)
             updateScale(1);
-        size_t idx = _nodes.size() ? (_nodes.rbegin()->first + 1) : 0;
+        size_t idx = _nodes.nextKey();
         node->idx = idx;
         _nodes[idx] = node;
+        _noteNodeAdded(node);
         if (node->content)
-            node->content->lvl = lvl + 1;
+            node->content->_updateHierarchy();
         if (moveEdges)
             checkForTransferEdges(node);
     }
@@ -133,17 +255,26 @@ namespace mhg {
                 e->hg->removeEdge(e);
             }
         }
+        _noteNodeRemoved(node);
         _nodes.erase(node->idx);
         if (!node->via && !node->hyper)
             updateScale(-1);
     }
 
     void HyperGraph::updateScale(int off) {
+        if (pmhg.inBatch()) {
+            if (!dp._scaleDeferred)
+                pmhg.deferScale(self);
+            dp._scaleDeferred = true;
+            dp._pendingScale += off;
+            return;
+        }
         float preCoeff = scale();
         dp.nDrawableNodes += off;
+        pmhg.invalidateScale();
         float aftCoeff = scale();
         for (auto& n : _nodes)
-            n.second->dp.pos = n.second->dp.pos * preCoeff / aftCoeff;
+            n.second->pos() = n.second->pos() * preCoeff / aftCoeff;
     }
 
     EdgePtr HyperGraph::addEdge(EdgeLinkStylePtr style, NodePtr from, NodePtr to, const EdgeLinkParams& params) {
@@ -154,8 +285,8 @@ namespace mhg {
             sim->fuse(edge);
             return sim;
         }
-        auto via = Node::create(self, _nodes.size() ? (_nodes.rbegin()->first + 1) : 0, {}, true, false);
-        auto idx = _edges.size() ? (_edges.rbegin()->first + 1) : 0;
+        auto via = Node::create(self, _nodes.nextKey(), {}, true, false);
+        auto idx = _edges.nextKey();
         auto edge = Edge::create(self, idx, from, via, to);
         edge->links.insert(EdgeLink::create(edge, style, params));
         addEdge(edge);
@@ -163,11 +294,11 @@ namespace mhg {
     }
 
     EdgePtr HyperGraph::cloneEdge(EdgePtr edge, NodePtr from, NodePtr to) {
-        auto via = Node::create(self, _nodes.size() ? (_nodes.rbegin()->first + 1) : 0, {}, true, false);
-        auto idx = _edges.size() ? (_edges.rbegin()->first + 1) : 0;
+        auto via = Node::create(self, _nodes.nextKey(), {}, true, false);
+        auto idx = _edges.nextKey();
         auto edge2 = Edge::create(self, idx, from, via, to);
         for (auto& l : edge->links) {
-            auto edge3 = std::make_shared<Edge>(self, 0, from, nullptr, to);
+            auto edge3 = Edge::create(self, 0, from, nullptr, to);
             auto link = EdgeLink::create(l);
             link->edge = edge2;
             edge3->links = {link};
@@ -180,8 +311,10 @@ namespace mhg {
     void HyperGraph::addEdge(EdgePtr edge) {
         addNode(edge->via);
         _edges[edge->idx] = edge;
+        _indexEdge(edge);
         edge->from->eOut.insert(edge);
         edge->to->eIn.insert(edge);
+        _noteEdgeAdded(edge);
     }
 
     void HyperGraph::removeEdge(EdgePtr edge, bool clear) {
@@ -191,6 +324,8 @@ namespace mhg {
         }
         removeNode(edge->via);
         _edges.erase(edge->idx);
+        _unindexEdge(edge);
+        _noteEdgeRemoved(edge);
     }
 
     void HyperGraph::reduceEdge(EdgePtr edge, bool clear) {
@@ -202,11 +337,13 @@ namespace mhg {
             
     void HyperGraph::transferEdge(EdgePtr edge) {
         edge->hg->removeEdge(edge, false);
-        size_t idx = _edges.size() ? (_edges.rbegin()->first + 1) : 0;
+        size_t idx = _edges.nextKey();
         _edges[idx] = edge;
         edge->hg = self;
         edge->idx = idx;
+        _indexEdge(edge);
         transferNode(edge->via, false);
+        _noteEdgeAdded(edge);
     }
 
     NodePtr HyperGraph::addHyperEdge(const EdgeLinksBundle& froms, const EdgeLinksBundle& tos) {
@@ -227,7 +364,7 @@ namespace mhg {
         for (auto l : edge->links)
             tos.push_back({l->style, edge->to});
         auto node = addHyperEdge(froms, tos);
-        node->dp.pos = (edge->from->dp.pos + edge->to->dp.pos) * 0.5f;
+        node->pos() = (edge->from->pos() + edge->to->pos()) * 0.5f;
         (*node->eIn.begin())->reposition();
         (*node->eOut.begin())->reposition();
         return node;
@@ -239,15 +376,20 @@ namespace mhg {
         hg->dp.nDrawableNodes = 0;
         hg->_nodes.clear();
         hg->_edges.clear();
+        std::map<Node*, NodePtr> clones;
         for (auto& n : _nodes)
-            hg->cloneNode(n.second);
+            clones[n.second.get()] = hg->cloneNode(n.second);
+        auto cloned = [&](const NodePtr& node) {
+            auto it = clones.find(node.get());
+            return (it != clones.end()) ? it->second : hg->getNode(node->idx);
+        };
         for (auto& n : _nodes) {
             for (auto& e : n.second->eIn) {
                 auto p = (e->hg == self) ? hg : e->hg;
                 if (!e->from->hg->isChildOf(self) || !e->to->hg->isChildOf(self)) {
                     p->cloneEdge(e, 
-                        e->from->hg->isChildOf(self) ? hg->_nodes[e->from->idx] : e->from,
-                        e->to->hg->isChildOf(self) ? hg->_nodes[e->to->idx] : e->to
+                        e->from->hg->isChildOf(self) ? cloned(e->from) : e->from,
+                        e->to->hg->isChildOf(self) ? cloned(e->to) : e->to
                     );
                 }
             }
@@ -255,32 +397,70 @@ namespace mhg {
                 auto p = (e->hg == self) ? hg : e->hg;
                 if (!e->from->hg->isChildOf(self) || !e->to->hg->isChildOf(self)) {
                     p->cloneEdge(e, 
-                        e->from->hg->isChildOf(self) ? hg->_nodes[e->from->idx] : e->from,
-                        e->to->hg->isChildOf(self) ? hg->_nodes[e->to->idx] : e->to
+                        e->from->hg->isChildOf(self) ? cloned(e->from) : e->from,
+                        e->to->hg->isChildOf(self) ? cloned(e->to) : e->to
                     );
                 }
             }
         }
         for (auto& e : _edges)
             if (e.second->from->hg->isChildOf(self) && e.second->to->hg->isChildOf(self))
-                hg->cloneEdge(e.second, hg->_nodes[e.second->from->idx], hg->_nodes[e.second->to->idx]);
+                hg->cloneEdge(e.second, cloned(e.second->from), cloned(e.second->to));
         return hg;
     }
 
     void HyperGraph::reposition(unsigned int seed) {
-        if (seed) 
-            srand(seed);
+        std::vector<HyperGraph*> levels;
+        _scatter(seed, levels);
+        std::vector<HyperGraph*> order(levels);
+        std::stable_sort(order.begin(), order.end(), [](HyperGraph* a, HyperGraph* b) {
+            return a->_nodes.size() > b->_nodes.size();
+        });
+        {
+            TaskGroup tasks;
+            for (auto hg : order)
+                tasks.run([hg]() { hg->layout(); });
+        }
+        for (auto hg : levels) {
+            for (auto& e : hg->_edges)
+                e.second->reposition();
+            hg->recenter();
+            hg->_dirtyNodes.clear();
+            hg->_newNodes.clear();
+        }
+    }
+
+    uint64_t HyperGraph::identity() {
+        return parent ? Rng::mix(parent->hg->identity(), parent->idx) : 0;
+    }
+
+    void HyperGraph::_scatter(unsigned int seed, std::vector<HyperGraph*>& levels) {
+        Rng rng(Rng::mix(seed, identity()));
         float angle;
         for (auto& n : _nodes) {
-            angle = 2.0f * 3.14159f * RAND_FLOAT;
-            n.second->dp.pos = NODE_SZ * Vector2{ cos(angle), sin(angle) };
+            angle = 2.0f * 3.14159f * rng.nextFloat();
+            n.second->pos() = NODE_SZ * Vector2{ cosf(angle), sinf(angle) };
             if (n.second->content)
-                n.second->content->reposition(seed);
+                n.second->content->_scatter(seed, levels);
+        }
+        levels.push_back(this);
+    }
+
+    void HyperGraph::layout() {
+        auto mode = (layoutMode == LayoutMode::DEFAULT) ? pmhg.getLayoutMode() : layoutMode;
+        if (_nodes.size() > DENSE_LAYOUT_MAX_NODES)
+            mode = LayoutMode::MULTILEVEL;
+        switch (mode) {
+        case LayoutMode::MULTILEVEL:
+            layoutStats = multilevelLayout();
+            break;
+        case LayoutMode::STRESS_MAJORIZATION:
+            layoutStats = stressMajorization();
+            break;
+        default:
+            layoutStats = kamadaKawai();
+            break;
         }
-        kamadaKawai();
-        for (auto& e : _edges)
-            e.second->reposition();
-        recenter();
     }
 
     void HyperGraph::_reindex() {
@@ -292,10 +472,208 @@ namespace mhg {
             e.second->idx = i++;
     }
 
+    const Matrix& HyperGraph::distances() {
+        size_t N = _nodes.size();
+        // Relaxing costs O(N^2) per edge and a rebuild O(N * (N + E)), so relax only a few.
+        if (_distVersion != _version || _pendingEdges.size() * N > N + adjacency().targets.size()) {
+            bfsDistances(_dist);
+            _distVersion = _version;
+            _distKeys.clear();
+            for (auto& n : _nodes)
+                _distKeys.push_back(n.first);
+            _pendingEdges.clear();
+            _droppedNodes.clear();
+            return _dist;
+        }
+        if (_distKeys.size() != N || !_droppedNodes.empty()) {
+            // Carry the rows of surviving nodes over to their current positions; nodes added
+            // since start unreachable, and the edges that reach them are still pending.
+            std::unordered_map<size_t, size_t> rowOf;
+            for (size_t r = 0; r < _distKeys.size(); ++r)
+                rowOf[_distKeys[r]] = r;
+            for (size_t key : _droppedNodes)
+                rowOf.erase(key);
+            std::vector<ptrdiff_t> src(N, -1);
+            _distKeys.clear();
+            for (auto& n : _nodes) {
+                auto it = rowOf.find(n.first);
+                if (it != rowOf.end())
+                    src[_distKeys.size()] = ptrdiff_t(it->second);
+                _distKeys.push_back(n.first);
+            }
+            Matrix D = Matrix::Constant(N, N, 1e9f);
+            for (size_t j = 0; j < N; ++j) {
+                if (src[j] >= 0)
+                    for (size_t i = 0; i < N; ++i)
+                        if (src[i] >= 0)
+                            D(i, j) = _dist(src[i], src[j]);
+                D(j, j) = 0.0f;
+            }
+            _dist = std::move(D);
+            _droppedNodes.clear();
+        }
+        for (auto& pe : _pendingEdges) {
+            size_t a = _nodes.position(pe.first);
+            size_t b = _nodes.position(pe.second);
+            Vector da = _dist.col(a), db = _dist.col(b);
+            auto relax = [&](size_t j) {
+                _dist.col(j) = _dist.col(j)
+                    .cwiseMin((da.array() + (db(j) + 1.0f)).matrix())
+                    .cwiseMin((db.array() + (da(j) + 1.0f)).matrix());
+            };
+            if (N >= LAYOUT_PARALLEL_MIN_NODES)
+                parallelFor(N, relax, 16);
+            else
+                for (size_t j = 0; j < N; ++j)
+                    relax(j);
+        }
+        _pendingEdges.clear();
+        return _dist;
+    }
+
+    EdgePtr HyperGraph::findEdge(Node* a, Node* b) {
+        auto it = _edgeIndex.find(NodePair(a, b));
+        return (it != _edgeIndex.end()) ? it->second : nullptr;
+    }
+
+    void HyperGraph::_indexEdge(EdgePtr edge) {
+        _edgeIndex.emplace(NodePair(edge->from.get(), edge->to.get()), edge);
+    }
+
+    void HyperGraph::_unindexEdge(EdgePtr edge) {
+        auto range = _edgeIndex.equal_range(NodePair(edge->from.get(), edge->to.get()));
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second == edge) {
+                _edgeIndex.erase(it);
+                return;
+            }
+    }
+
+    void HyperGraph::_adopt(NodePtr node) {
+        if (node->hg == self)
+            return;
+        size_t slot = states.acquire();
+        if (node->hg) {
+            states.copy(slot, node->hg->states, node->slot);
+            node->hg->states.release(node->slot);
+        }
+        node->slot = slot;
+        node->hg = self;
+    }
+
+    void HyperGraph::_noteNodeAdded(NodePtr node) {
+        // A new node has no edges yet, so it leaves _dist current; distances() gives it a row.
+        if (_distVersion == _version++)
+            _distVersion = _version;
+        if (!node->via && pmhg.isIncrementalLayout())
+            _newNodes.insert(node->idx);
+    }
+
+    void HyperGraph::_noteNodeRemoved(NodePtr node) {
+        _newNodes.erase(node->idx);
+        _dirtyNodes.erase(node->idx);
+        // Via nodes are never edge endpoints, so dropping one leaves every other distance as is.
+        if (_distVersion != _version++ || !node->via)
+            return;
+        for (auto& pe : _pendingEdges)
+            if (pe.first == node->idx || pe.second == node->idx)
+                return;
+        _droppedNodes.push_back(node->idx);
+        _distVersion = _version;
+    }
+
+    void HyperGraph::_noteEdgeAdded(EdgePtr edge) {
+        if (edge->from->hg.get() != this || edge->to->hg.get() != this || edge->from == edge->to)
+            return;
+        if (pmhg.isIncrementalLayout()) {
+            _dirtyNodes.insert(edge->from->idx);
+            _dirtyNodes.insert(edge->to->idx);
+        }
+        if (_distVersion != _version++ || _pendingEdges.size() >= _nodes.size())
+            return;
+        _pendingEdges.push_back({edge->from->idx, edge->to->idx});
+        _distVersion = _version;
+    }
+
+    void HyperGraph::_noteEdgeRemoved(EdgePtr edge) {
+        if (edge->from->hg.get() != this || edge->to->hg.get() != this || edge->from == edge->to)
+            return;
+        _version++;
+        if (!pmhg.isIncrementalLayout())
+            return;
+        if (_nodes.count(edge->from->idx))
+            _dirtyNodes.insert(edge->from->idx);
+        if (_nodes.count(edge->to->idx))
+            _dirtyNodes.insert(edge->to->idx);
+    }
+
+    void HyperGraph::_placeNewNodes() {
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (auto it = _newNodes.begin(); it != _newNodes.end();) {
+                auto node = _nodes.at(*it);
+                Vector2 acc = Vector2Zero();
+                size_t cnt = 0;
+                for (auto& e : node->eIn)
+                    if (e->from->hg.get() == this && e->from != node && !_newNodes.count(e->from->idx)) {
+                        acc += e->from->pos();
+                        cnt++;
+                    }
+                for (auto& e : node->eOut)
+                    if (e->to->hg.get() == this && e->to != node && !_newNodes.count(e->to->idx)) {
+                        acc += e->to->pos();
+                        cnt++;
+                    }
+                if (!cnt) {
+                    ++it;
+                    continue;
+                }
+                Rng rng(Rng::mix(identity(), node->idx));
+                float angle = 2.0f * 3.14159f * rng.nextFloat();
+                node->pos() = acc / cnt + NODE_SZ * Vector2{ cosf(angle), sinf(angle) };
+                _dirtyNodes.insert(node->idx);
+                it = _newNodes.erase(it);
+                progress = true;
+            }
+        }
+        _newNodes.clear();
+    }
+
+    const Adjacency& HyperGraph::adjacency() {
+        if (_adjVersion == _version)
+            return _adj;
+        size_t N = _nodes.size();
+        std::vector<std::pair<size_t, size_t>> pairs;
+        pairs.reserve(_edges.size());
+        for (auto& e : _edges) {
+            auto& from = e.second->from;
+            auto& to = e.second->to;
+            if (from->hg.get() != this || to->hg.get() != this || from == to)
+                continue;
+            pairs.push_back({_nodes.position(from->idx), _nodes.position(to->idx)});
+        }
+        _adj.offsets.assign(N + 1, 0);
+        for (auto& p : pairs) {
+            _adj.offsets[p.first + 1]++;
+            _adj.offsets[p.second + 1]++;
+        }
+        for (size_t i = 0; i < N; ++i)
+            _adj.offsets[i + 1] += _adj.offsets[i];
+        _adj.targets.resize(_adj.offsets.back());
+        std::vector<size_t> fill(_adj.offsets.begin(), _adj.offsets.end() - 1);
+        for (auto& p : pairs) {
+            _adj.targets[fill[p.first]++] = p.second;
+            _adj.targets[fill[p.second]++] = p.first;
+        }
+        _adjVersion = _version;
+        return _adj;
+    }
+
     Vector2 HyperGraph::getCenter() {
         Vector2 acc = Vector2Zero();
         for (auto n : _nodes)
-            acc += n.second->dp.pos;
+            acc += n.second->pos();
         return acc / _nodes.size();
     }            
     
@@ -305,37 +683,47 @@ namespace mhg {
     
     void HyperGraph::move(const Vector2 delta) {
         for (auto& n : _nodes)
-            n.second->dp.pos += delta;
+            n.second->pos() += delta;
     }
 
     void HyperGraph::draw(Vector2 origin, Vector2 offset, float s, const Font& font, bool physics, const std::map<NodePtr, std::pair<Vector2, Vector2>>& selectedNodes, 
         NodePtr& hoverNode, EdgeLinkPtr& hoverEdgeLink) 
     {
-        origin += (parent ? (parent->hg->scale() * parent->dp.pos) : Vector2Zero());
+        origin += (parent ? (parent->hg->scale() * parent->pos()) : Vector2Zero());
         Vector2 scaledOrigin = origin * s;
         dp._scaledOcache = scaledOrigin;
+        dp.culled = false;
         for (auto& n : _nodes)
             if (!n.second->via)
                 n.second->predraw(scaledOrigin, offset, s, font);
+        _gridDirty = true;
+        pmhg.nodeBatch().flush();
         for (auto& e : _edges) {
             auto hoverLink = e.second->draw(scaledOrigin, offset, s, font, physics, selectedNodes);
             if (hoverLink)
                 hoverEdgeLink = hoverLink;
         }
+        pmhg.edgeBatch().flush();
         for (auto& n : _nodes) {
             if (!n.second->via) {
                 if (n.second->draw(scaledOrigin, offset, s, font))
                     hoverNode = n.second;
             }
         }
+        pmhg.nodeBatch().flush();
+        // Whether this level sits inside a selected node, and which content levels right below
+        // it lead down to a selected node.
+        bool insideSelected = false;
+        std::set<HyperGraph*> aboveSelected;
+        for (auto& sn : selectedNodes) {
+            if (sn.first->content && isChildOf(sn.first->content))
+                insideSelected = true;
+            auto& chain = sn.first->hg->_ancestors;
+            if (chain.size() > size_t(lvl + 1) && chain[lvl] == this)
+                aboveSelected.insert(chain[lvl + 1]);
+        }
         for (auto& n : _nodes) {
-            bool childOrSelected = false;
-            for (auto& sn : selectedNodes) {
-                if ((sn.first == n.second) || sn.first->content && n.second->hg->isChildOf(sn.first->content)) {
-                    childOrSelected = true;
-                    break;
-                }
-            }
+            bool childOrSelected = insideSelected || selectedNodes.count(n.second);
             if (childOrSelected) {
                 for (auto& e : n.second->eIn)
                     if (e->hg->parent && s * e->hg->parent->hg->scale() > HIDE_CONTENT_SCALE)
@@ -345,30 +733,37 @@ namespace mhg {
                         e->draw(e->hg->dp._scaledOcache, offset, s, font, physics, selectedNodes);
             }
             if (n.second->content) {
-                bool parentOfSelected = false;
-                for (auto& sn : selectedNodes) {
-                    if (n.second->content && sn.first->hg->isChildOf(n.second->content)) {
-                        parentOfSelected = true;
-                        break;
-                    }
+                bool parentOfSelected = aboveSelected.count(n.second->content.get());
+                // Content is laid out around its parent at a fraction of the parent's scale, so a
+                // parent well off screen takes its whole subtree with it. Held nodes are always drawn.
+                float reach = 2 * n.second->rCacheStable() + NODE_BORDER + 8 * FONT_SZ;
+                if (!childOrSelected && !parentOfSelected && !isOnScreen(n.second->posCache(), reach)) {
+                    n.second->content->dp.culled = true;
+                    continue;
                 }
-                if ((s * scale() > HIDE_CONTENT_SCALE) || parentOfSelected)
+                if ((s * scale() > HIDE_CONTENT_SCALE) || parentOfSelected) {
+                    pmhg.edgeBatch().flush();
                     n.second->content->draw(origin, offset, s, font, physics, selectedNodes, hoverNode, hoverEdgeLink);
+                }
             }
         }
+        pmhg.edgeBatch().flush();
     }
 
     void HyperGraph::redrawSelected(Vector2 origin, Vector2 offset, float s, const Font& font, bool physics, const std::map<NodePtr, std::pair<Vector2, Vector2>>& selectedNodes, 
         NodePtr& hoverNode, EdgeLinkPtr& hoverEdgeLink) 
     {
-        origin += (parent ? (parent->hg->scale() * parent->dp.pos) : Vector2Zero());
+        origin += (parent ? (parent->hg->scale() * parent->pos()) : Vector2Zero());
         Vector2 scaledOrigin = origin * s;
         dp._scaledOcache = scaledOrigin;
         bool big = s * scale() > HIDE_CONTENT_SCALE;
         for (auto& n : _nodes) {
             if (selectedNodes.count(n.second)) {
+                pmhg.edgeBatch().flush();
                 n.second->predraw(scaledOrigin, offset, s, font);
+                _gridDirty = true;
                 n.second->draw(scaledOrigin, offset, s, font);
+                pmhg.nodeBatch().flush();
                 if (n.second->content && big)
                     n.second->content->draw(origin, offset, s, font, physics, selectedNodes, hoverNode, hoverEdgeLink);
                 for (auto& e : n.second->eIn)
@@ -381,6 +776,7 @@ namespace mhg {
                 n.second->content->redrawSelected(origin, offset, s, font, physics, selectedNodes, hoverNode, hoverEdgeLink);
             }
         }
+        pmhg.edgeBatch().flush();
     }
 
     void HyperGraph::resetDraw() {
@@ -399,35 +795,78 @@ namespace mhg {
         return all;
     }
 
-    NodePtr HyperGraph::getNodeAt(Vector2 pos, const std::set<NodePtr>& except) {
+    void HyperGraph::_updateGrid() {
+        if (!_gridDirty && _gridVersion == _version)
+            return;
+        std::vector<Vector2> points(_nodes.size(), Vector2{NAN, NAN});
+        _gridContent.clear();
+        _gridReach = 0;
+        size_t i = 0;
         for (auto& n : _nodes) {
-            if (n.second->via || n.second->hyper || except.count(n.second))
-                continue;
-            bool hover = (n.second->dp.rCacheStable * n.second->dp.rCacheStable > Vector2DistanceSqr(pos, n.second->dp.posCache));
-            if (hover) {
-                NodePtr node;
+            if (!n.second->via) {
+                points[i] = states.posCache[n.second->slot];
+                _gridReach = std::max(_gridReach, std::abs(states.rCacheStable[n.second->slot]));
                 if (n.second->content)
-                    node = n.second->content->getNodeAt(pos, except);
-                if (node)
-                    return node;
-                return n.second;
+                    _gridContent.push_back(i);
             }
+            i++;
+        }
+        _grid.build(points, _gridReach);
+        _gridVersion = _version;
+        _gridDirty = false;
+    }
+
+    bool HyperGraph::isCulled() {
+        for (auto hg : _ancestors)
+            if (hg->dp.culled)
+                return true;
+        return false;
+    }
+
+    Vector2 HyperGraph::origin() {
+        return parent ? (parent->hg->origin() + parent->hg->scale() * parent->pos()) : Vector2Zero();
+    }
+
+    NodePtr HyperGraph::getNodeAt(Vector2 pos, const std::set<NodePtr>& except) {
+        _updateGrid();
+        // The first hit in level order wins, as with a plain scan.
+        size_t hit = _nodes.size();
+        _grid.visit({pos.x - _gridReach, pos.y - _gridReach, 2 * _gridReach, 2 * _gridReach}, [&](size_t i) {
+            if (i >= hit)
+                return;
+            auto& node = _nodes.begin()[i].second;
+            float r = states.rCacheStable[node->slot];
+            bool hover = (r * r > Vector2DistanceSqr(pos, states.posCache[node->slot]));
+            if (hover && !node->hyper && !except.count(node))
+                hit = i;
+        });
+        if (hit == _nodes.size())
+            return nullptr;
+        auto& node = _nodes.begin()[hit].second;
+        if (node->content && !node->content->dp.culled) {
+            auto inner = node->content->getNodeAt(pos, except);
+            if (inner)
+                return inner;
         }
-        return nullptr;
+        return node;
     }
     
     void HyperGraph::getNodesIn(Rectangle rect, std::set<NodePtr>& result, const std::set<NodePtr>& except) {
-        for (auto& n : _nodes) {
-            if (n.second->via)
-                continue;
-            auto r = n.second->dp.rCache;
+        _updateGrid();
+        auto inside = [&](const NodePtr& node) {
+            auto r = states.rCache[node->slot];
             Rectangle radiusRect = {rect.x + r, rect.y + r, rect.width - r * 2, rect.height - r * 2};
-            if (!except.count(n.second)) {                
-                if (CheckCollisionPointRec(n.second->dp.posCache, radiusRect))
-                    result.insert(n.second);
-                else if (n.second->content)
-                    n.second->content->getNodesIn(rect, result, except);
-            }
+            return CheckCollisionPointRec(states.posCache[node->slot], radiusRect);
+        };
+        _grid.visit(rect, [&](size_t i) {
+            auto& node = _nodes.begin()[i].second;
+            if (!except.count(node) && inside(node))
+                result.insert(node);
+        });
+        for (size_t i : _gridContent) {
+            auto& node = _nodes.begin()[i].second;
+            if (node->content && !node->content->dp.culled && !except.count(node) && !inside(node))
+                node->content->getNodesIn(rect, result, except);
         }
     }
 }
\ No newline at end of file
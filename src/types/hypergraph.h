@@ -1,46 +1,111 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <list>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "base.h"
 #include "edge.h"
 #include "metahypergraph.h"
 #include "raylib.h"
 #include "raymath.h"
+#include "../util/rng.h"
+#include "../util/slot_map.h"
+#include "../util/spatial_grid.h"
 
 namespace mhg {
 
     struct HyperGraphDrawParams {
         int nDrawableNodes = 0;
         int _nDrawableNodesCache = -1;
+        int _pendingScale = 0;
+        bool _scaleDeferred = false;
+        // Set while the parent node is off screen and this level is left undrawn.
+        bool culled = false;
         float _scaleCache = 0;
+        size_t _scaleEpoch = 0;
         Vector2 _scaledOcache = Vector2Zero();
     };
 
+    // Undirected neighbour lists of a level in CSR form, indexed by local node position.
+    struct Adjacency {
+        std::vector<size_t> offsets;
+        std::vector<size_t> targets;
+    };
+
+    // Unordered endpoint pair of an edge, used to key the per-level edge index.
+    struct NodePair {
+        Node* a;
+        Node* b;
+
+        NodePair(Node* x, Node* y) : a(std::min(x, y)), b(std::max(x, y)) { }
+        bool operator==(const NodePair& o) const { return a == o.a && b == o.b; }
+    };
+
+    struct NodePairHash {
+        size_t operator()(const NodePair& p) const {
+            return Rng::mix(reinterpret_cast<uintptr_t>(p.a), reinterpret_cast<uintptr_t>(p.b));
+        }
+    };
+
+    // Per-frame layout and render state of a level's nodes, stored column-wise and addressed
+    // by Node::slot. Slots are recycled when a node is destroyed or moves to another level.
+    struct NodeStates {
+        std::vector<Vector2> pos;
+        std::vector<Vector2> posCache;
+        std::vector<float> rCache;
+        std::vector<float> rCacheStable;
+        std::vector<float> scaleCache;
+        std::vector<float> highlight;
+        std::vector<size_t> freeSlots;
+
+        size_t acquire();
+        void release(size_t slot);
+        void copy(size_t slot, const NodeStates& from, size_t fromSlot);
+    };
+
+    struct PhysicsSnapshot;
+
     class MetaHyperGraph;
     class HyperGraph {
         public:
             HyperGraph(MetaHyperGraph& pmhg, NodePtr parent = nullptr) : 
                 pmhg(pmhg), parent(parent), lvl(parent ? (parent->hg->lvl + 1) : 0)
-            { }
+            {
+                if (parent) {
+                    _ancestors = parent->hg->_ancestors;
+                    parent->hg->_gridDirty = true;
+                }
+                _ancestors.push_back(this);
+            }
 
             MetaHyperGraph& pmhg;
             HyperGraphPtr self = nullptr;
             NodePtr parent = nullptr;
             int lvl = 0;
+            LayoutMode layoutMode = LayoutMode::DEFAULT;
+            LayoutStats layoutStats;
 
             HyperGraphDrawParams dp;
+            NodeStates states;
 
             float coeff();
             float scale();
             size_t nodesCount();
 
             bool isChildOf(HyperGraphPtr hg);
+            bool isCulled();
+            Vector2 origin();
             void clear();
+            void release();
             void removeOuterEdges(HyperGraphPtr hg);
             void checkForTransferEdges(NodePtr node);
+            bool hasLinkClash(const EdgeLinkStylePtr& style, uint32_t id);
+            void restyle(const EdgeLinkStylePtr& style);
 
             NodePtr addNode(const std::string& label, const Color& color, bool via = false, bool hyper = false);
             void addNode(NodePtr node);
@@ -62,8 +127,19 @@ namespace mhg {
             void recalcTower(NodePtr in, NodePtr from = nullptr);
 
             void floydWarshall(Matrix& D);
-            void kamadaKawai();
+            void bfsDistances(Matrix& D);
+            void bfsDistances(Matrix& D, const std::vector<size_t>& sources);
+            const Matrix& distances();
+            size_t topologyVersion() { return _version; }
+            const Adjacency& adjacency();
+            LayoutStats kamadaKawai();
+            LayoutStats stressMajorization();
+            LayoutStats multilevelLayout();
+            void layout();
+            void capturePhysics(std::vector<PhysicsSnapshot>& levels);
             void reposition(unsigned int seed = 0);
+            void relayout();
+            uint64_t identity();
             
             Vector2 getCenter();
             void recenter();
@@ -77,14 +153,55 @@ namespace mhg {
             NodePtr getNodeAt(Vector2 pos, const std::set<NodePtr>& except);
             void getNodesIn(Rectangle rect, std::set<NodePtr>& result, const std::set<NodePtr>& except = {});
 
+            using NodeHandle = SlotMap<NodePtr>::Handle;
+            using EdgeHandle = SlotMap<EdgePtr>::Handle;
+
             NodePtr getNode(size_t idx) {return _nodes.count(idx) ? _nodes.at(idx) : nullptr;}
             EdgePtr getEdge(size_t idx) {return _edges.count(idx) ? _edges.at(idx) : nullptr;}
+            NodePtr getNode(NodeHandle h) {return _nodes.get(h);}
+            EdgePtr getEdge(EdgeHandle h) {return _edges.get(h);}
+            NodeHandle nodeHandle(size_t idx) {return _nodes.handle(idx);}
+            EdgeHandle edgeHandle(size_t idx) {return _edges.handle(idx);}
+            EdgePtr findEdge(Node* a, Node* b);
     
     private:
-            std::map<size_t, NodePtr> _nodes;
-            std::map<size_t, EdgePtr> _edges;
+            SlotMap<NodePtr> _nodes;
+            SlotMap<EdgePtr> _edges;
+            std::unordered_multimap<NodePair, EdgePtr, NodePairHash> _edgeIndex;
+
+            Matrix _dist;
+            size_t _version = 1;
+            size_t _distVersion = 0;
+            // Node key of each _dist row, and the edits made since, folded in by distances().
+            std::vector<size_t> _distKeys;
+            std::vector<std::pair<size_t, size_t>> _pendingEdges;
+            std::vector<size_t> _droppedNodes;
+            Adjacency _adj;
+            size_t _adjVersion = 0;
+            std::set<size_t> _dirtyNodes;
+            std::set<size_t> _newNodes;
+            // Levels from the root down to this one, so _ancestors[lvl] == this.
+            std::vector<HyperGraph*> _ancestors;
+            // Screen-space index of posCache for hit testing, rebuilt on the first query after
+            // a draw or a topology change. Holds local node positions.
+            SpatialGrid _grid;
+            std::vector<size_t> _gridContent;
+            float _gridReach = 0;
+            size_t _gridVersion = 0;
+            bool _gridDirty = true;
 
             void _reindex();
+            void _updateGrid();
+            void _scatter(unsigned int seed, std::vector<HyperGraph*>& levels);
+            void _adopt(NodePtr node);
+            void _updateHierarchy();
+            void _indexEdge(EdgePtr edge);
+            void _unindexEdge(EdgePtr edge);
+            void _noteNodeAdded(NodePtr node);
+            void _noteNodeRemoved(NodePtr node);
+            void _noteEdgeAdded(EdgePtr edge);
+            void _noteEdgeRemoved(EdgePtr edge);
+            void _placeNewNodes();
     };
 
 }
\ No newline at end of file
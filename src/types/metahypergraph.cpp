@@ -4,29 +4,78 @@
 #include "raylib.h"
 #include "raymath.h"
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <utility>
 
 namespace mhg {
+    MetaHyperGraph::~MetaHyperGraph() {
+        {
+            std::lock_guard<std::mutex> lock(_physicsLock);
+            _physicsStopping = true;
+        }
+        _physicsCv.notify_all();
+        if (_physicsThread.joinable())
+            _physicsThread.join();
+    }
+
     void MetaHyperGraph::clear() {
-        _root->clear();
+        _history.clear();
+        _root->release();
+        _styles.clear();
+        _styleIds.clear();
+        _arena = std::make_shared<Arena>();
+    }
+
+    uint32_t MetaHyperGraph::_styleId(Color color, const std::string& label) {
+        auto key = std::make_pair(label, (uint32_t(color.r) << 24) | (uint32_t(color.g) << 16) | (uint32_t(color.b) << 8) | color.a);
+        return _styleIds.emplace(key, uint32_t(_styleIds.size() + 1)).first->second;
+    }
+
+    EdgeLinkStylePtr MetaHyperGraph::internStyle(Color color, const std::string& label) {
+        auto& style = _styles[_styleId(color, label)];
+        if (!style)
+            style = internStyle(EdgeLinkStyle::create(color, label));
+        return style;
+    }
+
+    EdgeLinkStylePtr MetaHyperGraph::internStyle(EdgeLinkStylePtr style) {
+        style->id = _styleId(style->color, style->label);
+        return style;
+    }
+
+    bool MetaHyperGraph::restyle(EdgeLinkStylePtr style) {
+        _lock.lock();
+        uint32_t old = style->id;
+        uint32_t id = _styleId(style->color, style->label);
+        bool ok = (id == old) || !_root->hasLinkClash(style, id);
+        if (ok && id != old) {
+            style->id = id;
+            auto it = _styles.find(old);
+            if (it != _styles.end() && it->second == style)
+                _styles.erase(it);
+            _styles.emplace(id, style);
+            _root->restyle(style);
+        }
+        _lock.unlock();
+        return ok;
     }
 
     void MetaHyperGraph::init() {
         _lock.lock();
         _historyRecording = false;
-        _history = { MHGaction{.type = MHGactionType::SEP} };
-        _histIt = _history.begin();
+        _history.clear();
         if (!_root) {
             _root = std::make_shared<HyperGraph>(*this);
             _root->self = _root;
         }
         clear();
 
-        EdgeLinkStylePtr stl =  EdgeLinkStyle::create(RED, "test");
-        EdgeLinkStylePtr stl2 = EdgeLinkStyle::create(YELLOW, "test1");
-        EdgeLinkStylePtr stl3 = EdgeLinkStyle::create(GREEN, "test2");
+        EdgeLinkStylePtr stl =  internStyle(RED, "test");
+        EdgeLinkStylePtr stl2 = internStyle(YELLOW, "test1");
+        EdgeLinkStylePtr stl3 = internStyle(GREEN, "test2");
 
         auto a = addNode("A1", RED);
         auto aa = addNode("AA", RED, a);
@@ -95,6 +144,7 @@ namespace mhg {
         }
         auto node = hg->addNode(label, color);
         noticeAction({.type = MHGactionType::NODE, .inverse = false, .n = node}, false);
+        _relayout(hg);
         return node;
     }
 
@@ -125,6 +175,8 @@ namespace mhg {
                 }
             }
         }
+        for (auto& n : newNodes)
+            _relayout(n->hg);
         return newNodes;
     }
 
@@ -139,28 +191,35 @@ namespace mhg {
         auto eOut = node->eOut;
         for (auto& e : eOut)
             noticeAction({.type = MHGactionType::EDGE, .inverse = true, .e = e, .els = (*e->links.begin())->style, .elp = (*e->links.begin())->params}, false);
-        node->hg->removeNode(node);
-        noticeAction({.type = MHGactionType::NODE, .inverse = true, .n = node, .cur = node->dp.pos});
+        auto hg = node->hg;
+        hg->removeNode(node);
+        noticeAction({.type = MHGactionType::NODE, .inverse = true, .n = node, .cur = node->pos()});
+        _relayout(hg);
     }
 
     void MetaHyperGraph::moveNode(NodePtr node, Vector2 prvPos, Vector2 newPos) {
         noticeAction({.type = MHGactionType::MOVE, .inverse = false, .n = node, .prv = prvPos, .cur = newPos}, false);
         if (Vector2Length(prvPos - newPos) > 10) 
             noticeAction({.type = MHGactionType::SEP}, false);
-        node->dp.pos = newPos;
+        node->pos() = newPos;
     }
 
     void MetaHyperGraph::transferNode(HyperGraphPtr to, NodePtr node) {
         noticeAction({.type = MHGactionType::TRANSFER, .inverse = false, .hg = to, .from = node->hg, .n = node}, false);
+        auto from = node->hg;
         to->transferNode(node);
+        _relayout(from);
+        _relayout(to);
     }
 
     EdgePtr MetaHyperGraph::addEdge(EdgeLinkStylePtr style, NodePtr from, NodePtr to, const EdgeLinkParams& params) {
+        internStyle(style);
         auto hg = (from->hg->lvl > to->hg->lvl) ? from->hg : to->hg;
         auto edge = hg->addEdge(style, from, to, params);
         auto e = Edge::create(hg, edge->idx, from, edge->via, to);
         e->links.insert(EdgeLink::create(e, style, params));
         noticeAction({.type = MHGactionType::EDGE, .inverse = false, .e = (from->getEdgeTo(to)) ? e : edge, .els = style});
+        _relayout(hg);
         return edge;
     }
 
@@ -170,24 +229,30 @@ namespace mhg {
 
     void MetaHyperGraph::removeEdge(EdgePtr edge) {
         noticeAction({.type = MHGactionType::EDGE, .inverse = true, .e = edge, .els = (*edge->links.begin())->style, .elp = (*edge->links.begin())->params});
-        edge->hg->removeEdge(edge);
+        auto hg = edge->hg;
+        hg->removeEdge(edge);
+        _relayout(hg);
     }
 
     void MetaHyperGraph::reduceEdge(EdgePtr edge) {
         noticeAction({.type = MHGactionType::EDGE, .inverse = true, .e = edge, .els = (*edge->links.begin())->style, .elp = (*edge->links.begin())->params});
-        edge->hg->reduceEdge(edge);
+        auto hg = edge->hg;
+        hg->reduceEdge(edge);
+        _relayout(hg);
     }
 
     NodePtr MetaHyperGraph::addHyperEdge(const EdgeLinksBundle& froms, const EdgeLinksBundle& tos) {
         int maxLvl = 0;
         NodePtr maxLvlNode = nullptr;
         for (auto& from : froms) {
+            internStyle(from.first);
             if (from.second->hg->lvl > maxLvl) {
                 maxLvl = from.second->hg->lvl;
                 maxLvlNode = from.second;
             }
         }
         for (auto& to : tos) {
+            internStyle(to.first);
             if (to.second->hg->lvl > maxLvl) {
                 maxLvl = to.second->hg->lvl;
                 maxLvlNode = to.second;
@@ -195,15 +260,18 @@ namespace mhg {
         }
         auto hg = maxLvlNode ? maxLvlNode->hg : _root;
         auto hyperNode = hg->addHyperEdge(froms, tos);
+        _relayout(hg);
         return hyperNode;
     }
 
     NodePtr MetaHyperGraph::makeEdgeHyper(EdgePtr edge) {
         for (auto& l : edge->links)
             noticeAction({.type = MHGactionType::EDGE, .inverse = true, .e = edge, .els = l->style, .elp = l->params}, false);
-        auto hyperNode = edge->hg->makeEdgeHyper(edge);
+        auto hg = edge->hg;
+        auto hyperNode = hg->makeEdgeHyper(edge);
+        _relayout(hg);
         if (_historyRecording) {
-            noticeAction({.type = MHGactionType::NODE, .inverse = false, .n = hyperNode, .cur = hyperNode->dp.pos}, false);
+            noticeAction({.type = MHGactionType::NODE, .inverse = false, .n = hyperNode, .cur = hyperNode->pos()}, false);
             for (auto& e : hyperNode->eIn)
                 noticeAction({.type = MHGactionType::EDGE, .inverse = false, .e = e, .els = (*e->links.begin())->style, .elp = (*e->links.begin())->params}, false);
             for (auto& e : hyperNode->eOut)
@@ -217,6 +285,68 @@ namespace mhg {
         _root->reposition(seed);
     }
 
+    void MetaHyperGraph::_relayout(HyperGraphPtr hg) {
+        if (!_incrementalLayout || !hg)
+            return;
+        if (inBatch()) {
+            if (std::find(_batchRelayout.begin(), _batchRelayout.end(), hg) == _batchRelayout.end())
+                _batchRelayout.push_back(hg);
+            return;
+        }
+        hg->relayout();
+    }
+
+    void MetaHyperGraph::beginBatch() {
+        _lock.lock();
+        _batchDepth++;
+    }
+
+    void MetaHyperGraph::commit() {
+        if (--_batchDepth == 0) {
+            auto scaled = std::move(_batchScaled);
+            auto relayout = std::move(_batchRelayout);
+            _batchScaled.clear();
+            _batchRelayout.clear();
+            for (auto& hg : scaled) {
+                if (!hg->dp._scaleDeferred)
+                    continue;
+                int off = hg->dp._pendingScale;
+                hg->dp._pendingScale = 0;
+                hg->dp._scaleDeferred = false;
+                hg->updateScale(off);
+            }
+            for (auto& hg : relayout)
+                _relayout(hg);
+            noticeAction({.type = MHGactionType::SEP}, false);
+        }
+        _lock.unlock();
+    }
+
+    void MetaHyperGraph::setPhysicsEnabled(bool enabled) {
+        {
+            std::lock_guard<std::mutex> lock(_physicsLock);
+            _physicsEnabled = enabled;
+            if (enabled && !_physicsThread.joinable()) {
+                _physicsThread = std::thread([this]() {
+                    auto tick = std::chrono::microseconds(1000000 / PHYSICS_TICK_RATE);
+                    auto next = std::chrono::steady_clock::now();
+                    while (true) {
+                        {
+                            std::unique_lock<std::mutex> lock(_physicsLock);
+                            _physicsCv.wait(lock, [this]() { return _physicsEnabled || _physicsStopping; });
+                            if (_physicsStopping)
+                                return;
+                        }
+                        doPhysics();
+                        next = std::max(next + tick, std::chrono::steady_clock::now());
+                        std::this_thread::sleep_until(next);
+                    }
+                });
+            }
+        }
+        _physicsCv.notify_all();
+    }
+
     Vector2 MetaHyperGraph::getCenter() {
         return _root->getCenter();
     }
@@ -224,13 +354,12 @@ namespace mhg {
     void MetaHyperGraph::noticeAction(const MHGaction& action, bool sep) {
         if (!_historyRecording)
             return;
-        int n = (_history.end() - _histIt - 1);
-        for (int i = 0; i < n; ++i)
-            _history.pop_back();
-        _history.push_back(action);
-        if (sep)
-            _history.push_back(MHGaction{.type = MHGactionType::SEP});
-        _histIt = _history.end();
+        if (inBatch()) {
+            if (action.type != MHGactionType::SEP)
+                _history.push(action, false);
+            return;
+        }
+        _history.push(action, sep);
     }
 
     void MetaHyperGraph::_doAction(const MHGaction& action, bool inverse) {
@@ -249,6 +378,10 @@ namespace mhg {
             if (action.change) {
                 action.els->label = inv ? action.prvLabel : action.curLabel;
                 action.els->color = inv ? action.prvColor : action.curColor;
+                if (!restyle(action.els)) {
+                    action.els->label = inv ? action.curLabel : action.prvLabel;
+                    action.els->color = inv ? action.curColor : action.prvColor;
+                }
             } else {
                 if (inv) {
                     auto e = Edge::create(action.e->hg, action.e->idx, action.e->from, action.e->via, action.e->to);
@@ -265,7 +398,7 @@ namespace mhg {
             transferNode(inv ? action.from : action.hg, action.n);
             break;
         case MHGactionType::MOVE:
-            action.n->dp.pos = inv ? action.prv : action.cur;
+            action.n->pos() = inv ? action.prv : action.cur;
             break;
         case mhg::MHGactionType::HYPER:
             action.n->hyper = inv;
@@ -276,35 +409,23 @@ namespace mhg {
     }
 
     void MetaHyperGraph::undo() {
-        if (_histIt != _history.begin()) {
-            _historyRecording = false;
-            if (_histIt == _history.end())
-                _histIt--;
-            if (_histIt != _history.begin() && _histIt->type == MHGactionType::SEP)
-                _histIt--;
-            while (_histIt->type != MHGactionType::SEP) {
-                _doAction(*_histIt, true);
-                _histIt--;
-            }
-            _historyRecording = true;
-        }
+        _historyRecording = false;
+        _history.undo([&](const MHGaction& action) { _doAction(action, true); });
+        _historyRecording = true;
     }
 
     void MetaHyperGraph::redo() {
-        if (_histIt != _history.end()) {
-            _historyRecording = false;
-            if (_histIt->type == MHGactionType::SEP)
-                _histIt++;
-            while (_histIt != _history.end() && _histIt->type != MHGactionType::SEP) {
-                _doAction(*_histIt, false);
-                _histIt++;
-            }
-            _historyRecording = true;
-        }
+        _historyRecording = false;
+        _history.redo([&](const MHGaction& action) { _doAction(action, false); });
+        _historyRecording = true;
     }
 
     void MetaHyperGraph::draw(Vector2 offset, float scale, const Font& font, const std::map<NodePtr, std::pair<Vector2, Vector2>>& selectedNodes, NodePtr& hoverNode, EdgeLinkPtr& hoverEdgeLink) {
         _lock.lock();
+        _physicsPinned.clear();
+        if (_physicsEnabled)
+            for (auto& sn : selectedNodes)
+                _physicsPinned.insert(sn.first);
         _root->draw(Vector2Zero(), offset, scale, font, _physicsEnabled, selectedNodes, hoverNode, hoverEdgeLink);
         _root->redrawSelected(Vector2Zero(), offset, scale, font, _physicsEnabled, selectedNodes, hoverNode, hoverEdgeLink);
         _root->resetDraw();
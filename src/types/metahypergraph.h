@@ -1,38 +1,51 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <deque>
+#include <map>
+#include <set>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "base.h"
 #include "edge.h"
+#include "history.h"
 #include "hypergraph.h"
 #include "raylib.h"
+#include "../util/arena.h"
+#include "../util/edge_batch.h"
+#include "../util/node_batch.h"
 
 namespace mhg {
 
-    enum class MHGactionType { SEP, NODE, EDGE, MOVE, TRANSFER, HYPER };  
-    struct MHGaction {
-        MHGactionType type = MHGactionType::SEP;
-        bool inverse = false;
-        bool change = false;
-        HyperGraphPtr hg, from;
-        NodePtr n;
-        EdgePtr e;
-        EdgeLinkStylePtr els;
-        EdgeLinkParams elp = EdgeLinkParams{};
-        Vector2 prv, cur;
-        std::string prvLabel, curLabel;
-        Color prvColor, curColor;
-    };
-
     class DrawerImpl;
     class MetaHyperGraph {
         friend class DrawerImpl;
         public:
+            ~MetaHyperGraph();
+
             void clear();
             void init();
 
+            std::shared_ptr<Arena> arena() { return _arena; }
+            EdgeBatch& edgeBatch() { return _edgeBatch; }
+            NodeBatch& nodeBatch() { return _nodeBatch; }
+            // Styles are numbered per graph. The first overload returns the graph's shared style
+            // for a value, the second numbers a style of its own, as addEdge does for every style.
+            EdgeLinkStylePtr internStyle(Color color, const std::string& label = "");
+            EdgeLinkStylePtr internStyle(EdgeLinkStylePtr style);
+            // Re-keys a style after its colour or label was edited in place. Fails, leaving the id
+            // alone, if an edge would then hold two links of equal style; the caller reverts the edit.
+            bool restyle(EdgeLinkStylePtr style);
+
+            // Bumped whenever anything HyperGraph::scale() depends on changes, which drops every
+            // cached level scale at once.
+            void invalidateScale() { _scaleEpoch++; }
+            size_t scaleEpoch() { return _scaleEpoch; }
+
             NodePtr addNode(const std::string& label, const Color& color, NodePtr parent = nullptr);
             std::set<NodePtr> cloneNodes(const std::set<NodePtr>& nodes);
             void removeNode(NodePtr node);
@@ -47,8 +60,26 @@ namespace mhg {
             void reposition(unsigned int seed = 0);
             Vector2 getCenter();
 
+            bool isIncrementalLayout() { return _incrementalLayout; }
+            void setIncrementalLayout(bool enabled) { _incrementalLayout = enabled; }
+
+            bool isPhysicsEnabled() { return _physicsEnabled; }
+            void setPhysicsEnabled(bool enabled);
+            void doPhysics();
+
+            LayoutMode getLayoutMode() { return _layoutMode; }
+            void setLayoutMode(LayoutMode mode) { _layoutMode = (mode == LayoutMode::DEFAULT) ? LayoutMode::KAMADA_KAWAI : mode; }
+
+            // Groups every mutation up to the matching commit() into one undo step and defers level
+            // rescales and incremental relayouts to the commit. Holds _lock meanwhile; batches nest.
+            void beginBatch();
+            void commit();
+            bool inBatch() { return _batchDepth > 0; }
+            void deferScale(HyperGraphPtr hg) { _batchScaled.push_back(hg); }
+
             void undo();
             void redo();
+            void setHistoryLimit(size_t bytes) { _history.setLimit(bytes); }
 
             void draw(Vector2 offset, float scale, const Font& font, const std::map<NodePtr, std::pair<Vector2, Vector2>>& selectedNodes, NodePtr& hoverNode, EdgeLinkPtr& hoverEdgeLink);
 
@@ -59,18 +90,36 @@ namespace mhg {
             void noticeAction(const MHGaction& action, bool sep = true);
 
         private:
+            std::shared_ptr<Arena> _arena = std::make_shared<Arena>();
+            EdgeBatch _edgeBatch;
+            NodeBatch _nodeBatch;
             HyperGraphPtr _root;
+            size_t _scaleEpoch = 1;
+            std::map<std::pair<std::string, uint32_t>, uint32_t> _styleIds;
+            std::map<uint32_t, EdgeLinkStylePtr> _styles;
 
-            std::deque<MHGaction> _history;
-            std::deque<MHGaction>::iterator _histIt;
+            History _history;
             bool _historyRecording = false;
 
-            bool _physicsEnabled = false;
-
-            std::mutex _lock;
+            std::atomic<bool> _physicsEnabled = false;
+            bool _physicsStopping = false;
+            std::thread _physicsThread;
+            std::mutex _physicsLock;
+            std::condition_variable _physicsCv;
+            // Nodes the user is holding as of the last draw; physics leaves them where they are.
+            std::set<NodePtr> _physicsPinned;
+            LayoutMode _layoutMode = LayoutMode::KAMADA_KAWAI;
+            bool _incrementalLayout = false;
+
+            std::recursive_mutex _lock;
+            int _batchDepth = 0;
+            std::vector<HyperGraphPtr> _batchScaled;
+            std::vector<HyperGraphPtr> _batchRelayout;
 
             void _addNode(NodePtr node);
             void _addEdge(EdgePtr edge);
+            void _relayout(HyperGraphPtr hg);
+            uint32_t _styleId(Color color, const std::string& label);
             void _doAction(const MHGaction& action, bool inverse);
     };
 }
\ No newline at end of file
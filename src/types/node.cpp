@@ -4,10 +4,30 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 
 namespace mhg {
 
+    NodePtr Node::create(HyperGraphPtr hg, size_t idx, const NodeParams& params, bool via, bool hyper) {
+        auto node = std::allocate_shared<Node>(ArenaAllocator<Node>(hg ? hg->pmhg.arena() : nullptr), hg, idx, params, via, hyper);
+        if (hg)
+            node->slot = hg->states.acquire();
+        return node;
+    }
+
+    Node::~Node() {
+        if (hg && slot != size_t(-1))
+            hg->states.release(slot);
+    }
+
+    Vector2& Node::pos() { return hg->states.pos[slot]; }
+    Vector2& Node::posCache() { return hg->states.posCache[slot]; }
+    float& Node::rCache() { return hg->states.rCache[slot]; }
+    float& Node::rCacheStable() { return hg->states.rCacheStable[slot]; }
+    float& Node::scaleCache() { return hg->states.scaleCache[slot]; }
+    float& Node::highlight() { return hg->states.highlight[slot]; }
+
     float Node::coeff() {
         return 1.0f / ((content ? content->dp.nDrawableNodes : 0) + dp.tmpDrawableNodes + 1);
     }
@@ -38,51 +58,50 @@ namespace mhg {
         return nLinks;
     }
 
+    // An edge is stored in the deeper level of its two endpoints, so only their levels can hold it.
     EdgePtr Node::getEdgeTo(NodePtr node) {
-        for (auto& e : eIn)
-            if (e->from == node || e->to == node)
-                return e;
-        for (auto& e : eOut)
-            if (e->from == node || e->to == node)
-                return e;
-        return nullptr;
+        if (auto e = hg->findEdge(this, node.get()))
+            return e;
+        return (node->hg != hg) ? node->hg->findEdge(this, node.get()) : nullptr;
     }
 
     EdgePtr Node::getSimilarEdge(EdgePtr edge) {
-        for (auto& e : eIn)
-            if (e->similar(edge))
-                return e;
-        for (auto& e : eOut)
-            if (e->similar(edge))
-                return e;
-        return nullptr;
+        if (edge->from.get() != this && edge->to.get() != this)
+            return nullptr;
+        return getEdgeTo(edge->from.get() == this ? edge->to : edge->from);
     }
 
-    void Node::predraw(Vector2 origin, Vector2 offset, float scale, const Font& font) {
+    void Node::updateCache(Vector2 origin, Vector2 offset, float scale) {
         float ls = hg->scale() * scale;
-        Vector2 posmod = origin + dp.pos * ls + offset;
-        dp.posCache = posmod;
+        posCache() = origin + pos() * ls + offset;
         bool willDrop = (dp.overNode || dp.overRoot);;
         float ss = willDrop ? (dp.overRoot ? scale : (dp.overNode->scale() * scale)) : ls;
-        dp.scaleCache = ss;
-        if (hyper) {
-            float r = std::clamp((1 + getMaxLinks()) * EDGE_THICK * ss, 1.0f, (1 + getMaxLinks()) * EDGE_THICK);
-            dp.rCache = r;
-        } else {
-            float thick = std::clamp(NODE_BORDER * ss, 1.0f, NODE_BORDER);
-            float r = (NODE_SZ) * ss + thick;
-            dp.rCache = (NODE_SZ) * ss;
-            DrawCircleV(posmod, r, ColorBrightness({ 140, 140, 140, 255 }, dp.highlight));
+        scaleCache() = ss;
+        if (hyper)
+            rCache() = std::clamp((1 + getMaxLinks()) * EDGE_THICK * ss, 1.0f, (1 + getMaxLinks()) * EDGE_THICK);
+        else
+            rCache() = (NODE_SZ) * ss;
+        rCacheStable() = rCache() * (ls / ss);
+    }
+
+    void Node::predraw(Vector2 origin, Vector2 offset, float scale, const Font& font) {
+        updateCache(origin, offset, scale);
+        if (!hyper) {
+            float thick = std::clamp(NODE_BORDER * scaleCache(), 1.0f, NODE_BORDER);
+            float r = rCache() + thick;
+            if (isOnScreen(posCache(), r))
+                hg->pmhg.nodeBatch().circle(posCache(), r, ColorBrightness({ 140, 140, 140, 255 }, highlight()));
         }
-        dp.rCacheStable = dp.rCache * (ls / ss);
     }
 
     bool Node::draw(Vector2 origin, Vector2 offset, float scale, const Font& font) {
         float ls = hg->scale() * scale;
-        Vector2 posmod = origin + dp.pos * ls + offset;
+        Vector2 posmod = origin + pos() * ls + offset;
         bool hover;
         if (hyper) {
-            hover = (dp.rCache * dp.rCache > Vector2DistanceSqr(GetMousePosition(), posmod));
+            hover = (rCache() * rCache() > Vector2DistanceSqr(GetMousePosition(), posmod));
+            if (!isOnScreen(posmod, rCache()))
+                return hover;
             Vector3 c = Vector3Zero();
             float n = 0;
             for (auto& e : eIn) {
@@ -98,15 +117,19 @@ namespace mhg {
                 }
             }
             Color avgColor = (n > 0) ? Color{ uint8_t(c.x / n), uint8_t(c.y / n), uint8_t(c.z / n), 255 } : WHITE;
-            DrawCircleV(posmod, dp.rCache, ColorBrightness(avgColor, dp.highlight));
+            hg->pmhg.nodeBatch().circle(posmod, rCache(), ColorBrightness(avgColor, highlight()));
         } else {
-            float r = dp.rCache;
+            float r = rCache();
             hover = (r * r > Vector2DistanceSqr(GetMousePosition(), posmod));
+            bool drawLabel = dp.editing || ls > HIDE_TXT_SCALE;
+            // Glyphs are at most FONT_SZ wide, so this bounds the label wherever it is placed.
+            float reach = r + NODE_BORDER + (drawLabel ? FONT_SZ * (1.5f + 0.5f * p.label.size()) : 0.0f);
+            if (!isOnScreen(posmod, reach))
+                return hover;
             bool hasContent = content && content->nodesCount();
             bool drawContent = (hasContent && ls > HIDE_CONTENT_SCALE);
             Color c = dp.editing ? BLUE : ((hasContent && !drawContent) ? Color{ 140, 140, 140, 255 } : DARKGRAY);
-            DrawCircleV(posmod, r, c);
-            bool drawLabel = dp.editing || ls > HIDE_TXT_SCALE;
+            hg->pmhg.nodeBatch().circle(posmod, r, c);
             if (drawLabel) {
                 auto sz = MeasureTextEx(font, p.label.c_str(), FONT_SZ, 0);
                 Vector2 txtpos = posmod - sz * 0.5f;
@@ -117,14 +140,16 @@ namespace mhg {
                     float rr = r + thick;
                     txtpos.y += (rr + txtsz * 0.5f) * ((hg->lvl % 2) ? 1.0f : -1.0f);
                 }
-                DrawTextEx(font, p.label.c_str(), txtpos, txtsz, 0, WHITE);
+                hg->pmhg.nodeBatch().text(font, p.label, txtpos, txtsz, WHITE);
             }
         }
         return hover;
     }
 
     void Node::resetDraw() {
-        dp.highlight = 0.0f;
+        if (dp.tmpDrawableNodes || dp.overNode || dp.overRoot)
+            hg->pmhg.invalidateScale();
+        highlight() = 0.0f;
         dp.tmpDrawableNodes = 0;
         dp.overNode = nullptr;
         dp.overRoot = false;
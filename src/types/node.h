@@ -19,12 +19,6 @@ namespace mhg {
     };
 
     struct NodeDrawParams {
-        Vector2 pos = Vector2Zero();
-        Vector2 posCache;
-        float rCache;
-        float rCacheStable;
-        float scaleCache;
-        float highlight = 0.0f;
         bool editing = false;
         int tmpDrawableNodes = 0;
         NodePtr overNode = nullptr;
@@ -35,6 +29,7 @@ namespace mhg {
         HyperGraphPtr hg = nullptr;
         HyperGraphPtr content = nullptr;
         size_t idx = -1;
+        size_t slot = -1;
         bool via;
         bool hyper;
 
@@ -47,6 +42,15 @@ namespace mhg {
         Node(HyperGraphPtr hg, size_t idx, const NodeParams& params, bool via = false, bool hyper = false) :
             hg(hg), idx(idx), p(params), via(via), hyper(hyper)
         { }
+        ~Node();
+
+        // Hot layout and render state, stored in the owning level's NodeStates at `slot`.
+        Vector2& pos();
+        Vector2& posCache();
+        float& rCache();
+        float& rCacheStable();
+        float& scaleCache();
+        float& highlight();
 
         float coeff();        
         size_t nodesCount();
@@ -57,13 +61,12 @@ namespace mhg {
         EdgePtr getEdgeTo(NodePtr node);
         EdgePtr getSimilarEdge(EdgePtr edge);
 
+        void updateCache(Vector2 origin, Vector2 offset, float scale);
         void predraw(Vector2 origin, Vector2 offset, float scale, const Font& font);
         bool draw(Vector2 orign, Vector2 offset, float scale, const Font& font);
         void resetDraw();
 
-        static NodePtr create(HyperGraphPtr hg, size_t idx, const NodeParams& params, bool via = false, bool hyper = false) {
-            return std::make_shared<Node>(hg, idx, params, via, hyper);
-        }
+        static NodePtr create(HyperGraphPtr hg, size_t idx, const NodeParams& params, bool via = false, bool hyper = false);
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "arena.h"
+
+namespace mhg {
+
+    Arena::~Arena() {
+        for (auto slab : _slabs)
+            ::operator delete(slab);
+    }
+
+    void* Arena::allocate(size_t bytes) {
+        if (bytes > MAX_BLOCK)
+            return ::operator new(bytes);
+        size_t cls = (bytes + GRAIN - 1) / GRAIN - 1;
+        size_t size = (cls + 1) * GRAIN;
+        std::lock_guard<std::mutex> lock(_lock);
+        if (auto block = _free[cls]) {
+            _free[cls] = block->next;
+            return block;
+        }
+        if (_left < size) {
+            _cur = static_cast<char*>(::operator new(SLAB_SIZE));
+            _slabs.push_back(_cur);
+            _left = SLAB_SIZE;
+        }
+        void* p = _cur;
+        _cur += size;
+        _left -= size;
+        return p;
+    }
+
+    void Arena::deallocate(void* p, size_t bytes) {
+        if (bytes > MAX_BLOCK) {
+            ::operator delete(p);
+            return;
+        }
+        size_t cls = (bytes + GRAIN - 1) / GRAIN - 1;
+        auto block = static_cast<FreeBlock*>(p);
+        std::lock_guard<std::mutex> lock(_lock);
+        block->next = _free[cls];
+        _free[cls] = block;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mhg {
+
+    class Arena {
+        public:
+            Arena() = default;
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+            ~Arena();
+
+            void* allocate(size_t bytes);
+            void deallocate(void* p, size_t bytes);
+
+        private:
+            static constexpr size_t GRAIN = alignof(std::max_align_t);
+            static constexpr size_t MAX_BLOCK = 1024;
+            static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+            struct FreeBlock { FreeBlock* next; };
+
+            std::mutex _lock;
+            std::vector<char*> _slabs;
+            char* _cur = nullptr;
+            size_t _left = 0;
+            FreeBlock* _free[MAX_BLOCK / GRAIN] = {};
+    };
+
+    template<typename T>
+    struct ArenaAllocator {
+        using value_type = T;
+
+        std::shared_ptr<Arena> arena;
+
+        explicit ArenaAllocator(std::shared_ptr<Arena> arena) : arena(std::move(arena)) { }
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) { }
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(arena ? arena->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
+        }
+        void deallocate(T* p, size_t n) {
+            if (arena)
+                arena->deallocate(p, n * sizeof(T));
+            else
+                ::operator delete(p);
+        }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+    };
+
+}
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "../types/edge.h"
+#include "../types/hypergraph.h"
 #include "raylib.h"
 #include "raymath.h"
 
+#include <algorithm>
+
 void mhg::Edge::findArrowPositionBezier(Vector2 p0, Vector2 c1, Vector2 p2, bool atStart, float scale, Vector2& pos, float& angle, float& t) {
     auto node = atStart ? from : to;
     auto nodepos = atStart ? p0 : p2;
@@ -16,7 +19,7 @@ void mhg::Edge::findArrowPositionBezier(Vector2 p0, Vector2 c1, Vector2 p2, bool
         pos = getPoint(p0, c1, p2, middle);
         float distToPt = Vector2Distance(pos, nodepos);
         angle = atan2(nodepos.y - pos.y, nodepos.x - pos.x);
-        float distToBorder = node->dp.rCache;
+        float distToBorder = node->rCache();
         float diff = distToBorder - distToPt;
         if (abs(diff) < threshold)
             break;
@@ -39,36 +42,35 @@ void mhg::Edge::findArrowPositionBezier(Vector2 p0, Vector2 c1, Vector2 p2, bool
     t = middle;
   } 
 
-#define SPLINE_SEGMENT_DIVISIONS 24
+#define SPLINE_MAX_SEGMENT_DIVISIONS 64
+#define SPLINE_FLATNESS 0.25f
 bool mhg::Edge::DrawSplineSegmentBezierQuadraticPart(Vector2 p0, Vector2 c1, Vector2 p2, float thick, Color color, float start, float end, float highlight)
 {
-    const float step = (end - start)/SPLINE_SEGMENT_DIVISIONS;
+    // B(t) = A*t^2 + B*t + p0. The second derivative 2*A is constant, so a chord over dt strays
+    // at most |A|*dt^2/4 from the curve: take just enough chords to stay within SPLINE_FLATNESS
+    // pixels, which is a single one for straight or tiny links.
+    Vector2 A = p0 - 2.0f*c1 + p2;
+    Vector2 B = 2.0f*(c1 - p0);
+    float span = fabsf(end - start);
+    int divisions = (int)ceilf(span*sqrtf(Vector2Length(A)/(4.0f*SPLINE_FLATNESS)));
+    divisions = std::clamp(divisions, 1, SPLINE_MAX_SEGMENT_DIVISIONS);
+
+    // Forward differencing: the first difference grows by a constant second difference per step.
+    const float step = (end - start)/divisions;
+    Vector2 previous = (A*start + B)*start + p0;
+    Vector2 delta = A*(step*(2.0f*start + step)) + B*step;
+    const Vector2 delta2 = A*(2.0f*step*step);
 
-    Vector2 previous = p0;
-    if (start != 0) {
-        float a = powf(1.0f - start, 2);
-        float b = 2.0f*(1.0f - start)*start;
-        float c = powf(start, 2);
-        previous.y = a*p0.y + b*c1.y + c*p2.y;
-        previous.x = a*p0.x + b*c1.x + c*p2.x;
-    }
     bool hover = false;
+    Vector2 mouse = GetMousePosition();
     Vector2 current = { 0 };
-    float t;
 
-    Vector2 points[2*SPLINE_SEGMENT_DIVISIONS + 2];
+    Vector2 points[2*SPLINE_MAX_SEGMENT_DIVISIONS + 2];
 
-    for (int i = 1; i <= SPLINE_SEGMENT_DIVISIONS; i++)
+    for (int i = 1; i <= divisions; i++)
     {
-        t = start + step * i;
-
-        float a = powf(1.0f - t, 2);
-        float b = 2.0f*(1.0f - t)*t;
-        float c = powf(t, 2);
-
-        // NOTE: The easing functions aren't suitable here because they don't take a control point
-        current.y = a*p0.y + b*c1.y + c*p2.y;
-        current.x = a*p0.x + b*c1.x + c*p2.x;
+        current = previous + delta;
+        delta = delta + delta2;
 
         float dy = current.y - previous.y;
         float dx = current.x - previous.x;
@@ -87,11 +89,11 @@ bool mhg::Edge::DrawSplineSegmentBezierQuadraticPart(Vector2 p0, Vector2 c1, Vec
         points[2*i].x = current.x + dy*size;
         points[2*i].y = current.y - dx*size;
 
-        hover |= CheckCollisionPointLine(GetMousePosition(), previous, current, thick * 2);
+        hover |= CheckCollisionPointLine(mouse, previous, current, thick * 2);
 
         previous = current;
     }
 
-    DrawTriangleStrip(points, 2*SPLINE_SEGMENT_DIVISIONS + 2, ColorBrightness(color, highlight));
+    hg->pmhg.edgeBatch().strip(points, 2*divisions + 2, ColorBrightness(color, highlight));
     return hover;
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "../types/hypergraph.h"
+#include "parallel.h"
+
+void mhg::HyperGraph::bfsDistances(mhg::Matrix& D) {
+    std::vector<size_t> sources(_nodes.size());
+    for (size_t s = 0; s < sources.size(); ++s)
+        sources[s] = s;
+    bfsDistances(D, sources);
+}
+
+void mhg::HyperGraph::bfsDistances(mhg::Matrix& D, const std::vector<size_t>& sources) {
+    size_t N = _nodes.size();
+    const auto& adj = adjacency();
+    const auto& offsets = adj.offsets;
+    const auto& targets = adj.targets;
+    D = mhg::Matrix::Constant(N, sources.size(), 1e9f);
+    parallelFor(sources.size(), [&](size_t c) {
+        size_t s = sources[c];
+        std::vector<size_t> queue(N);
+        std::vector<int> dist(N, -1);
+        size_t head = 0, tail = 0;
+        queue[tail++] = s;
+        dist[s] = 0;
+        while (head < tail) {
+            size_t u = queue[head++];
+            for (size_t k = offsets[u]; k < offsets[u + 1]; ++k) {
+                size_t v = targets[k];
+                if (dist[v] < 0) {
+                    dist[v] = dist[u] + 1;
+                    queue[tail++] = v;
+                }
+            }
+        }
+        auto col = D.col(c);
+        for (size_t i = 0; i < tail; ++i)
+            col[queue[i]] = float(dist[queue[i]]);
+    }, 16);
+}
\ No newline at end of file
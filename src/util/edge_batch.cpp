@@ -0,0 +1,67 @@
+#include "edge_batch.h"
+#include "rlgl.h"
+
+#include <cmath>
+
+namespace mhg {
+
+    void EdgeBatch::strip(const Vector2* points, int count, Color color) {
+        if (count < 3)
+            return;
+        _strips.push_back({_points.size(), count, color});
+        _points.insert(_points.end(), points, points + count);
+    }
+
+    // Same corners as DrawTextureEx, which rotates the quad around its top-left corner.
+    void EdgeBatch::texture(Texture2D tex, Vector2 pos, float rotation, float scale, Color tint) {
+        if (tex.id != _texture.id)
+            flush();
+        _texture = tex;
+        float w = tex.width * scale, h = tex.height * scale;
+        float s = sinf(rotation * DEG2RAD), c = cosf(rotation * DEG2RAD);
+        _quads.push_back({{
+            {pos.x, pos.y},
+            {pos.x - h * s, pos.y + h * c},
+            {pos.x + w * c - h * s, pos.y + w * s + h * c},
+            {pos.x + w * c, pos.y + w * s}
+        }, tint});
+    }
+
+    void EdgeBatch::flush() {
+        if (!_strips.empty()) {
+            rlBegin(RL_TRIANGLES);
+            for (auto& st : _strips) {
+                const Vector2* p = _points.data() + st.begin;
+                rlCheckRenderBatchLimit(3 * (st.count - 2));
+                rlColor4ub(st.color.r, st.color.g, st.color.b, st.color.a);
+                for (int i = 2; i < st.count; i++) {
+                    bool even = (i % 2 == 0);
+                    rlVertex2f(p[i].x, p[i].y);
+                    rlVertex2f(p[even ? i - 2 : i - 1].x, p[even ? i - 2 : i - 1].y);
+                    rlVertex2f(p[even ? i - 1 : i - 2].x, p[even ? i - 1 : i - 2].y);
+                }
+            }
+            rlEnd();
+            _strips.clear();
+            _points.clear();
+        }
+        if (!_quads.empty()) {
+            static const Vector2 uv[4] = {{0, 0}, {0, 1}, {1, 1}, {1, 0}};
+            rlSetTexture(_texture.id);
+            rlBegin(RL_QUADS);
+            rlNormal3f(0.0f, 0.0f, 1.0f);
+            for (auto& q : _quads) {
+                rlCheckRenderBatchLimit(4);
+                rlColor4ub(q.tint.r, q.tint.g, q.tint.b, q.tint.a);
+                for (int k = 0; k < 4; ++k) {
+                    rlTexCoord2f(uv[k].x, uv[k].y);
+                    rlVertex2f(q.corners[k].x, q.corners[k].y);
+                }
+            }
+            rlEnd();
+            rlSetTexture(0);
+            _quads.clear();
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "raylib.h"
+
+namespace mhg {
+
+    // Collects the link strips and arrow heads drawn between two flushes and submits them to rlgl
+    // as one triangle run and one textured quad run, instead of interleaving them per link.
+    // Whoever draws something else in between has to flush first to keep the stacking order.
+    class EdgeBatch {
+        public:
+            void strip(const Vector2* points, int count, Color color);
+            void texture(Texture2D tex, Vector2 pos, float rotation, float scale, Color tint);
+            void flush();
+
+        private:
+            struct Strip {
+                size_t begin;
+                int count;
+                Color color;
+            };
+            struct Quad {
+                Vector2 corners[4];
+                Color tint;
+            };
+
+            std::vector<Vector2> _points;
+            std::vector<Strip> _strips;
+            std::vector<Quad> _quads;
+            Texture2D _texture = {};
+    };
+
+}
\ No newline at end of file
@@ -1,73 +1,175 @@
 #include "../types/hypergraph.h"
+#include "parallel.h"
+#include "simd.h"
 
-void mhg::HyperGraph::kamadaKawai() {
+#include <chrono>
+#include <vector>
+
+using namespace mhg::simd;
+
+mhg::LayoutStats mhg::HyperGraph::kamadaKawai() {
+    auto start = std::chrono::steady_clock::now();
     size_t N = _nodes.size();
-    mhg::Matrix D; floydWarshall(D);
+    std::vector<NodePtr> nodes;
+    nodes.reserve(N);
+    for (auto& n : _nodes)
+        nodes.push_back(n.second);
+    std::vector<float> px(N), py(N);
+    for (size_t i = 0; i < N; ++i) {
+        px[i] = nodes[i]->pos().x;
+        py[i] = nodes[i]->pos().y;
+    }
+
+    const mhg::Matrix& D = distances();
     mhg::Matrix L   = SPRING_LEN * D;
     mhg::Matrix K   = SPRING_STR * D.array().pow(-2);
     mhg::Matrix Ex  = mhg::Matrix::Zero(N, N);
     mhg::Matrix Ey  = mhg::Matrix::Zero(N, N);
     mhg::Vector Exs = mhg::Vector::Zero(N);
     mhg::Vector Eys = mhg::Vector::Zero(N);
-    for (size_t m = 0; m < N; ++m) {
-        const auto& pos_m = _nodes[m]->dp.pos;
-        for (size_t i = m; i < N; ++i) {
-            if (i != m) {
-                const auto& pos_i = _nodes[i]->dp.pos;
-                const float denom = 1.0f / Vector2Distance(pos_m, pos_i);
-                const auto E = K(m, i) * (pos_m - pos_i - L(m, i) * (pos_m - pos_i) * denom);
-                Ex(m, i) = Ex(i, m) = E.x;
-                Ey(m, i) = Ey(i, m) = E.y;
-                Exs(m) += E.x;
-                Eys(m) += E.y;
-            }
+
+    // D is symmetric, so column m of K and L holds row m contiguously. Ex(i, m) and Ey(i, m)
+    // hold the contribution of node i to the gradient of node m for the same reason.
+    auto buildE = [&](size_t m) {
+        const float* k = K.col(m).data();
+        const float* l = L.col(m).data();
+        float* ex = Ex.col(m).data();
+        float* ey = Ey.col(m).data();
+        const vfloat pmx = set1(px[m]), pmy = set1(py[m]);
+        vfloat sx = set1(0.0f), sy = set1(0.0f);
+        size_t i = m + 1;
+        for (; i + WIDTH <= N; i += WIDTH) {
+            vfloat dx = pmx - load(&px[i]);
+            vfloat dy = pmy - load(&py[i]);
+            vfloat denom = set1(1.0f) / simd::sqrt(dx * dx + dy * dy);
+            vfloat kk = load(k + i), ll = load(l + i) * denom;
+            vfloat ux = kk * (dx - ll * dx);
+            vfloat uy = kk * (dy - ll * dy);
+            store(ex + i, ux);
+            store(ey + i, uy);
+            sx += ux;
+            sy += uy;
         }
-    }
+        float sxs = hsum(sx), sys = hsum(sy);
+        for (; i < N; ++i) {
+            const float dx = px[m] - px[i], dy = py[m] - py[i];
+            const float denom = 1.0f / std::sqrt(dx * dx + dy * dy);
+            ex[i] = k[i] * (dx - l[i] * dx * denom);
+            ey[i] = k[i] * (dy - l[i] * dy * denom);
+            sxs += ex[i];
+            sys += ey[i];
+        }
+        Exs(m) = sxs;
+        Eys(m) = sys;
+    };
+    if (N >= LAYOUT_PARALLEL_MIN_NODES)
+        parallelFor(N, buildE, 16);
+    else
+        for (size_t m = 0; m < N; ++m)
+            buildE(m);
+    Ex.triangularView<Eigen::StrictlyUpper>() = Ex.transpose();
+    Ey.triangularView<Eigen::StrictlyUpper>() = Ey.transpose();
 
     auto getEnrg = [&](size_t idx, Vector2& dE_dpos, float& dM) {
         dE_dpos = {Exs[idx], Eys[idx]};
         dM = Vector2Length(dE_dpos);
     };
 
-    auto getHighestEnergyNode = [&](size_t& maxEnrgNodeId, float& maxEnrg, Vector2& max_dE_dpos) {
-        Vector2 dE_dpos; float dM; float maxE = 0;
+    // Squared gradient magnitudes, kept current by updateE so finding the next node to move
+    // is a single pass over a contiguous array.
+    std::vector<float> enrg2(N);
+    for (size_t m = 0; m < N; ++m)
+        enrg2[m] = Exs[m] * Exs[m] + Eys[m] * Eys[m];
+
+    auto getHighestEnergyNode = [&](size_t& maxEnrgNodeId, float& maxEnrg) {
+        float maxE2 = 0.0f;
         for (size_t m = 0; m < N; ++m) {
-            getEnrg(m, dE_dpos, dM);
-            if (dM > maxE) {
-                maxE = dM;
+            if (enrg2[m] > maxE2) {
+                maxE2 = enrg2[m];
                 maxEnrgNodeId = m;
-                max_dE_dpos = dE_dpos;
             }
         }
-        maxEnrg = maxE;
+        maxEnrg = std::sqrt(maxE2);
+    };
+
+    auto updateERange = [&](size_t idx, size_t begin, size_t end, vfloat& sx, vfloat& sy, float& sxs, float& sys) {
+        const float* k = K.col(idx).data();
+        const float* l = L.col(idx).data();
+        float* ex = Ex.col(idx).data();
+        float* ey = Ey.col(idx).data();
+        float* exs = Exs.data();
+        float* eys = Eys.data();
+        float* e2 = enrg2.data();
+        const vfloat pmx = set1(px[idx]), pmy = set1(py[idx]);
+        size_t i = begin;
+        for (; i + WIDTH <= end; i += WIDTH) {
+            vfloat dx = pmx - load(&px[i]);
+            vfloat dy = pmy - load(&py[i]);
+            vfloat denom = set1(1.0f) / simd::sqrt(dx * dx + dy * dy);
+            vfloat kk = load(k + i), ll = load(l + i) * denom;
+            vfloat ux = kk * (dx - ll * dx);
+            vfloat uy = kk * (dy - ll * dy);
+            vfloat nx = load(exs + i) + ux - load(ex + i);
+            vfloat ny = load(eys + i) + uy - load(ey + i);
+            store(exs + i, nx);
+            store(eys + i, ny);
+            store(e2 + i, nx * nx + ny * ny);
+            store(ex + i, ux);
+            store(ey + i, uy);
+            sx += ux;
+            sy += uy;
+        }
+        for (; i < end; ++i) {
+            const float dx = px[idx] - px[i], dy = py[idx] - py[i];
+            const float denom = 1.0f / std::sqrt(dx * dx + dy * dy);
+            const float ux = k[i] * (dx - l[i] * dx * denom);
+            const float uy = k[i] * (dy - l[i] * dy * denom);
+            exs[i] += ux - ex[i];
+            eys[i] += uy - ey[i];
+            e2[i] = exs[i] * exs[i] + eys[i] * eys[i];
+            ex[i] = ux;
+            ey[i] = uy;
+            sxs += ux;
+            sys += uy;
+        }
     };
 
     auto updateE = [&](size_t idx) {
-        const auto& posM = _nodes[idx]->dp.pos;
-        Vector2 dE_dpos = Vector2Zero();
-        for (size_t i = 0; i < N; ++i) {
-            if (i != idx) {
-                const float oldDx = Ex(idx, i);
-                const float oldDy = Ey(idx, i);
-                const auto& posI = _nodes[i]->dp.pos;
-                const float denom = 1.0f / Vector2Distance(posI, posM);
-                float dx = K(idx, i) * (posM.x - posI.x - L(idx, i) * (posM.x - posI.x) * denom);
-                float dy = K(idx, i) * (posM.y - posI.y - L(idx, i) * (posM.y - posI.y) * denom);
-                Ex(idx, i) = dx;
-                Ey(idx, i) = dy;
-                dE_dpos += {dx, dy};
-                Exs(i) += dx - oldDx;
-                Eys(i) += dy - oldDy;
-            }
+        vfloat sx = set1(0.0f), sy = set1(0.0f);
+        float sxs = 0.0f, sys = 0.0f;
+        updateERange(idx, 0, idx, sx, sy, sxs, sys);
+        updateERange(idx, idx + 1, N, sx, sy, sxs, sys);
+        Exs(idx) = hsum(sx) + sxs;
+        Eys(idx) = hsum(sy) + sys;
+        enrg2[idx] = Exs(idx) * Exs(idx) + Eys(idx) * Eys(idx);
+    };
+
+    auto hessianRange = [&](size_t idx, size_t begin, size_t end, vfloat& a, vfloat& b, vfloat& c, float& as, float& bs, float& cs) {
+        const float* k = K.col(idx).data();
+        const float* l = L.col(idx).data();
+        const vfloat pmx = set1(px[idx]), pmy = set1(py[idx]);
+        size_t i = begin;
+        for (; i + WIDTH <= end; i += WIDTH) {
+            vfloat dx = pmx - load(&px[i]);
+            vfloat dy = pmy - load(&py[i]);
+            vfloat d2 = dx * dx + dy * dy;
+            vfloat kk = load(k + i);
+            vfloat ll = load(l + i) / (d2 * simd::sqrt(d2));
+            a += kk * (set1(1.0f) - ll * dy * dy);
+            b += kk * (ll * dx * dy);
+            c += kk * (set1(1.0f) - ll * dx * dx);
+        }
+        for (; i < end; ++i) {
+            const float dx = px[idx] - px[i], dy = py[idx] - py[i];
+            const float d2 = dx * dx + dy * dy;
+            const float ll = l[i] / (d2 * std::sqrt(d2));
+            as += k[i] * (1.0f - ll * dy * dy);
+            bs += k[i] * (ll * dx * dy);
+            cs += k[i] * (1.0f - ll * dx * dx);
         }
-        Exs(idx) = dE_dpos.x;
-        Eys(idx) = dE_dpos.y;
     };
 
-    const float THRESH = 1e-2f;
-    const float INNER_THRESH = 1.0f;
-    const int MAX_ITS = std::max(1000, std::min(10 * int(N), 6000));
-    const int MAX_INNER_ITS = 5;
+    const int maxIts = std::max(KK_MIN_ITS, std::min(KK_ITS_PER_NODE * int(N), KK_MAX_ITS));
     int its = 0;
     int subIts = 0;
     float maxEnrg = 1e9f, dM = 0.0f;
@@ -75,21 +177,13 @@ void mhg::HyperGraph::kamadaKawai() {
     Vector2 dE_dpos;
 
     auto moveNode = [&](size_t idx, Vector2 dE_dpos) {
-        float d2E_dx2 = 0;
-        float d2E_dxdy = 0;
-        float d2E_dy2 = 0;
-        const auto& posM = _nodes[idx]->dp.pos;
-        for (size_t i = 0; i < N; ++i) {
-            if (i != idx) {
-                const auto& posI = _nodes[i]->dp.pos;
-                const float denom = 1.0f / std::pow(Vector2DistanceSqr(posM, posI), 1.5);
-                const float kmat = K(idx, i);
-                const float lmat = L(idx, i);
-                d2E_dx2 += kmat * (1.0f - lmat * (posM.y - posI.y) * (posM.y - posI.y) * denom);
-                d2E_dxdy += kmat * (lmat * (posM.x - posI.x) * (posM.y - posI.y) * denom);
-                d2E_dy2 += kmat * (1.0f - lmat * (posM.x - posI.x) * (posM.x - posI.x) * denom);
-            }
-        }
+        vfloat a = set1(0.0f), b = set1(0.0f), c = set1(0.0f);
+        float as = 0.0f, bs = 0.0f, cs = 0.0f;
+        hessianRange(idx, 0, idx, a, b, c, as, bs, cs);
+        hessianRange(idx, idx + 1, N, a, b, c, as, bs, cs);
+        const float d2E_dx2 = hsum(a) + as;
+        const float d2E_dxdy = hsum(b) + bs;
+        const float d2E_dy2 = hsum(c) + cs;
         const auto& A = d2E_dx2;
         const auto& B = d2E_dxdy;
         const auto& C = dE_dpos.x;
@@ -97,18 +191,27 @@ void mhg::HyperGraph::kamadaKawai() {
         const auto& J = dE_dpos.y;
         const float dy = (C / A + J / B) / (B / A - I / B);
         const float dx = -(B * dy + C) / A;
-        _nodes[idx]->dp.pos += {dx, dy};
+        px[idx] += dx;
+        py[idx] += dy;
         updateE(idx);
     };
-    while (maxEnrg > THRESH && its < MAX_ITS) {
-        getHighestEnergyNode(maxEnrgNodeId, maxEnrg, dE_dpos);
-        dM = maxEnrg;
+    while (maxEnrg > KK_THRESH && its < maxIts) {
+        getHighestEnergyNode(maxEnrgNodeId, maxEnrg);
+        if (maxEnrg <= KK_THRESH)
+            break;
+        getEnrg(maxEnrgNodeId, dE_dpos, dM);
         subIts = 0;
-        while (dM > INNER_THRESH && subIts < MAX_INNER_ITS) {
+        while (dM > KK_INNER_THRESH && subIts < KK_MAX_INNER_ITS) {
             moveNode(maxEnrgNodeId, dE_dpos);
             getEnrg(maxEnrgNodeId, dE_dpos, dM);
             subIts++;
         }
         its++;
     }
+
+    for (size_t i = 0; i < N; ++i)
+        nodes[i]->pos() = {px[i], py[i]};
+
+    getHighestEnergyNode(maxEnrgNodeId, maxEnrg);
+    return LayoutStats{its, maxEnrg, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "../types/hypergraph.h"
+#include "parallel.h"
+#include "quadtree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+    struct CoarseLevel {
+        std::vector<size_t> offsets, targets;
+        std::vector<float> weights, mass;
+        std::vector<size_t> group;
+        size_t size() const { return mass.size(); }
+    };
+
+    // Heavy-edge matching; nodes left unmatched then join the group of their heaviest neighbour,
+    // so stars and other hub-heavy levels still shrink quickly.
+    CoarseLevel coarsen(CoarseLevel& fine) {
+        size_t N = fine.size();
+        std::vector<size_t> order(N);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return fine.offsets[a + 1] - fine.offsets[a] < fine.offsets[b + 1] - fine.offsets[b];
+        });
+        const size_t NONE = size_t(-1);
+        fine.group.assign(N, NONE);
+        CoarseLevel coarse;
+        for (size_t u : order) {
+            if (fine.group[u] != NONE)
+                continue;
+            size_t best = NONE;
+            for (size_t k = fine.offsets[u]; k < fine.offsets[u + 1]; ++k) {
+                size_t v = fine.targets[k];
+                if (fine.group[v] != NONE || v == u)
+                    continue;
+                if (best == NONE || fine.weights[k] > fine.weights[best] || 
+                    (fine.weights[k] == fine.weights[best] && fine.mass[v] < fine.mass[fine.targets[best]]))
+                    best = k;
+            }
+            if (best == NONE)
+                continue;
+            fine.group[u] = fine.group[fine.targets[best]] = coarse.mass.size();
+            coarse.mass.push_back(fine.mass[u] + fine.mass[fine.targets[best]]);
+        }
+        for (size_t u : order) {
+            if (fine.group[u] != NONE)
+                continue;
+            size_t best = NONE;
+            for (size_t k = fine.offsets[u]; k < fine.offsets[u + 1]; ++k)
+                if (best == NONE || fine.weights[k] > fine.weights[best])
+                    best = k;
+            if (best != NONE && fine.group[fine.targets[best]] != NONE) {
+                fine.group[u] = fine.group[fine.targets[best]];
+                coarse.mass[fine.group[u]] += fine.mass[u];
+            } else {
+                fine.group[u] = coarse.mass.size();
+                coarse.mass.push_back(fine.mass[u]);
+            }
+        }
+
+        std::vector<std::pair<std::pair<size_t, size_t>, float>> edges;
+        for (size_t u = 0; u < N; ++u)
+            for (size_t k = fine.offsets[u]; k < fine.offsets[u + 1]; ++k)
+                if (fine.group[u] != fine.group[fine.targets[k]])
+                    edges.push_back({{fine.group[u], fine.group[fine.targets[k]]}, fine.weights[k]});
+        std::sort(edges.begin(), edges.end());
+        coarse.offsets.assign(coarse.size() + 1, 0);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            if (i && edges[i].first == edges[i - 1].first) {
+                coarse.weights.back() += edges[i].second;
+                continue;
+            }
+            coarse.offsets[edges[i].first.first + 1]++;
+            coarse.targets.push_back(edges[i].first.second);
+            coarse.weights.push_back(edges[i].second);
+        }
+        for (size_t i = 0; i < coarse.size(); ++i)
+            coarse.offsets[i + 1] += coarse.offsets[i];
+        return coarse;
+    }
+
+    // Returns the largest net force on a node in the last iteration.
+    float refine(const CoarseLevel& lvl, std::vector<float>& px, std::vector<float>& py, float k, int its) {
+        size_t N = lvl.size();
+        std::vector<float> fx(N), fy(N);
+        mhg::QuadTree tree;
+        float temp = k, maxForce = 0.0f;
+        for (int it = 0; it < its; ++it) {
+            maxForce = 0.0f;
+            tree.build(px.data(), py.data(), lvl.mass.data(), N);
+            mhg::parallelFor(N, [&](size_t i) {
+                Vector2 f = tree.repulsion(i, PHYSICS_THETA, k * k);
+                for (size_t e = lvl.offsets[i]; e < lvl.offsets[i + 1]; ++e) {
+                    size_t j = lvl.targets[e];
+                    float dx = px[j] - px[i], dy = py[j] - py[i];
+                    float s = lvl.weights[e] * std::sqrt(dx * dx + dy * dy) / k;
+                    f.x += dx * s;
+                    f.y += dy * s;
+                }
+                fx[i] = f.x / lvl.mass[i];
+                fy[i] = f.y / lvl.mass[i];
+            }, 256);
+            for (size_t i = 0; i < N; ++i) {
+                float len = std::sqrt(fx[i] * fx[i] + fy[i] * fy[i]);
+                maxForce = std::max(maxForce, len);
+                if (len > temp) {
+                    fx[i] *= temp / len;
+                    fy[i] *= temp / len;
+                }
+                px[i] += fx[i];
+                py[i] += fy[i];
+            }
+            temp = std::max(temp * MULTILEVEL_COOLING, 0.01f * k);
+        }
+        return maxForce;
+    }
+
+}
+
+mhg::LayoutStats mhg::HyperGraph::multilevelLayout() {
+    auto start = std::chrono::steady_clock::now();
+    size_t N = _nodes.size();
+    std::vector<NodePtr> nodes;
+    nodes.reserve(N);
+    for (auto& n : _nodes)
+        nodes.push_back(n.second);
+
+    std::vector<CoarseLevel> levels(1);
+    levels[0].offsets = adjacency().offsets;
+    levels[0].targets = adjacency().targets;
+    levels[0].weights.assign(levels[0].targets.size(), 1.0f);
+    levels[0].mass.assign(N, 1.0f);
+    while (levels.back().size() > MULTILEVEL_COARSEST) {
+        auto coarse = coarsen(levels.back());
+        if (coarse.size() > MULTILEVEL_MIN_SHRINK * levels.back().size())
+            break;
+        levels.push_back(std::move(coarse));
+    }
+
+    // Isolated nodes (via nodes included) keep their starting positions and are left out of the
+    // force computation, so each level only carries the connected part of the graph.
+    auto connected = [&](const CoarseLevel& lvl, size_t i) { return lvl.offsets[i + 1] > lvl.offsets[i]; };
+
+    std::vector<float> px(levels.back().size()), py(levels.back().size());
+    for (size_t i = 0; i < N; ++i) {
+        size_t g = i;
+        for (size_t l = 0; l + 1 < levels.size(); ++l)
+            g = levels[l].group[g];
+        px[g] = nodes[i]->pos().x;
+        py[g] = nodes[i]->pos().y;
+    }
+
+    float k = SPRING_LEN * std::pow(MULTILEVEL_SPRING_GROWTH, float(levels.size() - 1));
+    int totalIts = 0;
+    float energy = 0.0f;
+    for (size_t l = levels.size(); l-- > 0;) {
+        auto& lvl = levels[l];
+        std::vector<size_t> active;
+        for (size_t i = 0; i < lvl.size(); ++i)
+            if (connected(lvl, i))
+                active.push_back(i);
+        CoarseLevel sub;
+        std::vector<size_t> local(lvl.size(), size_t(-1));
+        for (size_t i = 0; i < active.size(); ++i)
+            local[active[i]] = i;
+        sub.offsets.push_back(0);
+        std::vector<float> sx(active.size()), sy(active.size());
+        for (size_t i = 0; i < active.size(); ++i) {
+            size_t u = active[i];
+            for (size_t e = lvl.offsets[u]; e < lvl.offsets[u + 1]; ++e) {
+                sub.targets.push_back(local[lvl.targets[e]]);
+                sub.weights.push_back(lvl.weights[e]);
+            }
+            sub.offsets.push_back(sub.targets.size());
+            sub.mass.push_back(lvl.mass[u]);
+            sx[i] = px[u];
+            sy[i] = py[u];
+        }
+        int its = (l + 1 == levels.size()) ? MULTILEVEL_COARSEST_ITS : MULTILEVEL_ITS;
+        energy = refine(sub, sx, sy, k, its);
+        totalIts += its;
+        for (size_t i = 0; i < active.size(); ++i) {
+            px[active[i]] = sx[i];
+            py[active[i]] = sy[i];
+        }
+        if (!l)
+            break;
+        auto& fine = levels[l - 1];
+        std::vector<float> fx(fine.size()), fy(fine.size());
+        for (size_t i = 0; i < fine.size(); ++i) {
+            size_t g = fine.group[i];
+            Vector2 jitter = {0, 0};
+            if (l == 1)
+                jitter = nodes[i]->pos() * MULTILEVEL_JITTER;
+            else
+                jitter = Vector2{std::cos(float(i)), std::sin(float(i))} * (NODE_SZ * MULTILEVEL_JITTER);
+            fx[i] = connected(fine, i) ? px[g] + jitter.x : px[g];
+            fy[i] = connected(fine, i) ? py[g] + jitter.y : py[g];
+        }
+        px.swap(fx);
+        py.swap(fy);
+        k /= MULTILEVEL_SPRING_GROWTH;
+    }
+
+    for (size_t i = 0; i < N; ++i)
+        if (connected(levels[0], i))
+            nodes[i]->pos() = {px[i], py[i]};
+
+    return LayoutStats{totalIts, energy, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "node_batch.h"
+#include "raymath.h"
+#include "rlgl.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+namespace mhg {
+
+    static const char* CIRCLE_VS = R"(
+in vec2 vertexPosition;
+in vec4 instanceCircle;
+in vec4 instanceColor;
+uniform mat4 mvp;
+out vec2 fragCoord;
+out float fragRadius;
+out vec4 fragColor;
+void main() {
+    fragCoord = vertexPosition * (instanceCircle.z + 1.0);
+    fragRadius = instanceCircle.z;
+    fragColor = instanceColor;
+    gl_Position = mvp * vec4(instanceCircle.xy + fragCoord, 0.0, 1.0);
+}
+)";
+
+    static const char* CIRCLE_FS = R"(
+in vec2 fragCoord;
+in float fragRadius;
+in vec4 fragColor;
+out vec4 finalColor;
+void main() {
+    float coverage = clamp(fragRadius - length(fragCoord) + 0.5, 0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+    finalColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
+)";
+
+    void NodeBatch::circle(Vector2 center, float radius, Color color) {
+        _instances.push_back({center.x, center.y, radius, 0.0f, color});
+    }
+
+    void NodeBatch::text(const Font& font, const std::string& text, Vector2 pos, float size, Color tint) {
+        _labels.push_back({&font, text, pos, size, tint});
+    }
+
+    void NodeBatch::_init() {
+        _mode = Mode::FALLBACK;
+        int version = rlGetVersion();
+        bool es = (version == RL_OPENGL_ES_30);
+        if (version != RL_OPENGL_33 && version != RL_OPENGL_43 && !es)
+            return;
+        std::string header = es ? "#version 300 es\nprecision mediump float;\n" : "#version 330\n";
+        _shader = LoadShaderFromMemory((header + CIRCLE_VS).c_str(), (header + CIRCLE_FS).c_str());
+        if (!IsShaderValid(_shader) || _shader.id == rlGetShaderIdDefault())
+            return;
+        _mvpLoc = GetShaderLocation(_shader, "mvp");
+        _circleLoc = GetShaderLocationAttrib(_shader, "instanceCircle");
+        _colorLoc = GetShaderLocationAttrib(_shader, "instanceColor");
+        int posLoc = GetShaderLocationAttrib(_shader, "vertexPosition");
+        if (_mvpLoc < 0 || _circleLoc < 0 || _colorLoc < 0 || posLoc < 0)
+            return;
+
+        static const float quad[12] = {-1, -1, 1, -1, 1, 1, -1, -1, 1, 1, -1, 1};
+        _vao = rlLoadVertexArray();
+        rlEnableVertexArray(_vao);
+        _quadVbo = rlLoadVertexBuffer(quad, sizeof(quad), false);
+        rlSetVertexAttribute(posLoc, 2, RL_FLOAT, false, 0, 0);
+        rlEnableVertexAttribute(posLoc);
+        rlDisableVertexArray();
+        _mode = Mode::INSTANCED;
+    }
+
+    // (Re)creates the instance buffer big enough for the current batch and points the
+    // per-instance attributes at it.
+    void NodeBatch::_bindInstances() {
+        if (_instanceVbo)
+            rlUnloadVertexBuffer(_instanceVbo);
+        _capacity = std::max(_instances.size(), 2 * _capacity);
+        _instanceVbo = rlLoadVertexBuffer(nullptr, int(_capacity * sizeof(Instance)), true);
+        rlSetVertexAttribute(_circleLoc, 4, RL_FLOAT, false, sizeof(Instance), offsetof(Instance, x));
+        rlEnableVertexAttribute(_circleLoc);
+        rlSetVertexAttributeDivisor(_circleLoc, 1);
+        rlSetVertexAttribute(_colorLoc, 4, RL_UNSIGNED_BYTE, true, sizeof(Instance), offsetof(Instance, color));
+        rlEnableVertexAttribute(_colorLoc);
+        rlSetVertexAttributeDivisor(_colorLoc, 1);
+    }
+
+    void NodeBatch::flush() {
+        if (_mode == Mode::UNINITIALIZED && !_instances.empty())
+            _init();
+        if (!_instances.empty()) {
+            if (_mode == Mode::INSTANCED) {
+                // Whatever raylib has queued so far belongs underneath.
+                rlDrawRenderBatchActive();
+                rlEnableShader(_shader.id);
+                rlSetUniformMatrix(_mvpLoc, MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+                rlEnableVertexArray(_vao);
+                if (_instances.size() > _capacity)
+                    _bindInstances();
+                rlUpdateVertexBuffer(_instanceVbo, _instances.data(), int(_instances.size() * sizeof(Instance)), 0);
+                rlDrawVertexArrayInstanced(0, 6, int(_instances.size()));
+                rlDisableVertexArray();
+                rlDisableShader();
+            } else {
+                for (auto& c : _instances)
+                    DrawCircleV({c.x, c.y}, c.r, c.color);
+            }
+            _instances.clear();
+        }
+        for (auto& l : _labels)
+            DrawTextEx(*l.font, l.text.c_str(), l.pos, l.size, 0, l.tint);
+        _labels.clear();
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "raylib.h"
+
+namespace mhg {
+
+    // Collects the node discs and labels drawn between two flushes. Discs go to the GPU as
+    // instances of one quad and are cut out by a signed-distance shader, falling back to
+    // DrawCircleV where instancing is unavailable. Labels are drawn after the discs. Like
+    // EdgeBatch, whoever draws something else in between has to flush first. GPU objects are
+    // created on the first flush and left to the GL context to release.
+    class NodeBatch {
+        public:
+            void circle(Vector2 center, float radius, Color color);
+            void text(const Font& font, const std::string& text, Vector2 pos, float size, Color tint);
+            void flush();
+
+        private:
+            struct Instance {
+                float x, y, r, pad;
+                Color color;
+            };
+            struct Label {
+                const Font* font;
+                std::string text;
+                Vector2 pos;
+                float size;
+                Color tint;
+            };
+
+            std::vector<Instance> _instances;
+            std::vector<Label> _labels;
+
+            enum class Mode { UNINITIALIZED, INSTANCED, FALLBACK } _mode = Mode::UNINITIALIZED;
+            Shader _shader = {};
+            int _mvpLoc = -1, _circleLoc = -1, _colorLoc = -1;
+            unsigned int _vao = 0, _quadVbo = 0, _instanceVbo = 0;
+            size_t _capacity = 0;
+
+            void _init();
+            void _bindInstances();
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+#include "thread_pool.h"
+
+namespace mhg {
+
+    inline size_t hardwareThreads() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    template<typename F>
+    void parallelFor(size_t n, F&& f, size_t grain = 1) {
+        grain = std::max<size_t>(grain, 1);
+        auto& pool = ThreadPool::shared();
+        size_t nHelpers = std::min(pool.size(), (n + grain - 1) / grain - std::min<size_t>(n, 1));
+        if (!nHelpers) {
+            for (size_t i = 0; i < n; ++i)
+                f(i);
+            return;
+        }
+        struct Job {
+            std::atomic<size_t> next = 0;
+            std::atomic<size_t> done = 0;
+        };
+        auto job = std::make_shared<Job>();
+        auto run = [job, n, grain, &f]() {
+            for (size_t begin = job->next.fetch_add(grain); begin < n; begin = job->next.fetch_add(grain)) {
+                size_t end = std::min(n, begin + grain);
+                for (size_t i = begin; i < end; ++i)
+                    f(i);
+                job->done.fetch_add(end - begin);
+            }
+        };
+        for (size_t t = 0; t < nHelpers; ++t)
+            pool.submit(run);
+        run();
+        while (job->done.load() < n)
+            if (!pool.runPending())
+                std::this_thread::yield();
+    }
+
+    class TaskGroup {
+        public:
+            TaskGroup() : _pool(ThreadPool::shared()) { }
+            ~TaskGroup() { wait(); }
+
+            template<typename F>
+            void run(F&& f) {
+                _pending.fetch_add(1);
+                _pool.submit([this, f = std::forward<F>(f)]() {
+                    f();
+                    _pending.fetch_sub(1);
+                });
+            }
+
+            void wait() {
+                while (_pending.load())
+                    if (!_pool.runPending())
+                        std::this_thread::yield();
+            }
+
+        private:
+            ThreadPool& _pool;
+            std::atomic<size_t> _pending = 0;
+    };
+
+}
\ No newline at end of file
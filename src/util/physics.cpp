@@ -0,0 +1,104 @@
+#include "../types/metahypergraph.h"
+#include "../types/node.h"
+#include "parallel.h"
+#include "quadtree.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+namespace mhg {
+
+    struct PhysicsSnapshot {
+        HyperGraphPtr hg;
+        std::vector<HyperGraph::NodeHandle> nodes;
+        std::vector<float> px, py, mass;
+        std::vector<Vector2> captured;
+        std::vector<std::pair<size_t, size_t>> springs;
+        std::vector<std::array<size_t, 3>> vias;
+    };
+
+    void HyperGraph::capturePhysics(std::vector<PhysicsSnapshot>& levels) {
+        auto& s = levels.emplace_back();
+        s.hg = self;
+        std::unordered_map<Node*, size_t> local;
+        auto add = [&](const NodePtr& n, float mass) {
+            local[n.get()] = s.nodes.size();
+            s.nodes.push_back(nodeHandle(n->idx));
+            s.px.push_back(n->pos().x);
+            s.py.push_back(n->pos().y);
+            s.captured.push_back(n->pos());
+            s.mass.push_back(mass);
+        };
+        for (auto& n : _nodes)
+            if (!n.second->via)
+                add(n.second, 1.0f);
+        for (auto& e : _edges) {
+            auto from = local.find(e.second->from.get());
+            auto to = local.find(e.second->to.get());
+            if (from == local.end() || to == local.end() || from->second == to->second)
+                continue;
+            s.springs.push_back({from->second, to->second});
+            if (e.second->via && e.second->via->hg.get() == this) {
+                s.vias.push_back({s.nodes.size(), from->second, to->second});
+                add(e.second->via, PHYSICS_VIA_CHARGE);
+            }
+        }
+        for (auto& n : _nodes)
+            if (n.second->content)
+                n.second->content->capturePhysics(levels);
+    }
+
+    static void simulate(PhysicsSnapshot& s, float dt) {
+        size_t N = s.nodes.size();
+        if (!N)
+            return;
+        const float k = SPRING_LEN;
+        QuadTree tree;
+        tree.build(s.px.data(), s.py.data(), s.mass.data(), N);
+        std::vector<Vector2> f(N);
+        parallelFor(N, [&](size_t i) {
+            f[i] = tree.repulsion(i, PHYSICS_THETA, k * k) * s.mass[i] - Vector2{s.px[i], s.py[i]} * PHYSICS_GRAVITY;
+        }, 256);
+        for (auto& sp : s.springs) {
+            Vector2 d = {s.px[sp.second] - s.px[sp.first], s.py[sp.second] - s.py[sp.first]};
+            Vector2 pull = d * (Vector2Length(d) / k);
+            f[sp.first] += pull;
+            f[sp.second] -= pull;
+        }
+        for (auto& v : s.vias) {
+            Vector2 mid = {0.5f * (s.px[v[1]] + s.px[v[2]]), 0.5f * (s.py[v[1]] + s.py[v[2]])};
+            f[v[0]] = f[v[0]] + (mid - Vector2{s.px[v[0]], s.py[v[0]]}) * PHYSICS_VIA_STIFFNESS;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            Vector2 step = f[i] * dt;
+            float len = Vector2Length(step);
+            if (len > PHYSICS_MAX_STEP)
+                step = step * (PHYSICS_MAX_STEP / len);
+            s.px[i] += step.x;
+            s.py[i] += step.y;
+        }
+    }
+
+    void MetaHyperGraph::doPhysics() {
+        std::vector<PhysicsSnapshot> levels;
+        _lock.lock();
+        if (_root)
+            _root->capturePhysics(levels);
+        _lock.unlock();
+        parallelFor(levels.size(), [&](size_t i) { simulate(levels[i], PHYSICS_STEP); });
+        // The step ran unlocked: a node dragged, moved, undone or re-laid out in the meantime
+        // keeps its new position instead of being reset to the stale one.
+        _lock.lock();
+        for (auto& s : levels)
+            for (size_t i = 0; i < s.nodes.size(); ++i) {
+                auto node = s.hg->getNode(s.nodes[i]);
+                if (!node || _physicsPinned.count(node) || !(node->pos() == s.captured[i]))
+                    continue;
+                node->pos() = {s.px[i], s.py[i]};
+            }
+        _lock.unlock();
+    }
+
+}
\ No newline at end of file
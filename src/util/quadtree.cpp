@@ -0,0 +1,104 @@
+#include "quadtree.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define QUADTREE_MAX_DEPTH 24
+
+namespace mhg {
+
+    void QuadTree::build(const float* px, const float* py, const float* mass, size_t n) {
+        _px = px;
+        _py = py;
+        _mass = mass;
+        _cells.clear();
+        _order.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            _order[i] = i;
+        if (!n)
+            return;
+        float minX = px[0], maxX = px[0], minY = py[0], maxY = py[0];
+        for (size_t i = 1; i < n; ++i) {
+            minX = std::min(minX, px[i]);
+            maxX = std::max(maxX, px[i]);
+            minY = std::min(minY, py[i]);
+            maxY = std::max(maxY, py[i]);
+        }
+        float half = 0.5f * std::max(maxX - minX, maxY - minY) + 1.0f;
+        _cells.reserve(2 * n);
+        _build(0.5f * (minX + maxX), 0.5f * (minY + maxY), half, 0, n, 0);
+    }
+
+    int QuadTree::_build(float cx, float cy, float half, size_t begin, size_t end, int depth) {
+        int idx = int(_cells.size());
+        _cells.push_back(Cell{cx, cy, half});
+        _cells[idx].begin = begin;
+        _cells[idx].end = end;
+        float mx = 0, my = 0, mass = 0;
+        for (size_t i = begin; i < end; ++i) {
+            size_t p = _order[i];
+            mx += _mass[p] * _px[p];
+            my += _mass[p] * _py[p];
+            mass += _mass[p];
+        }
+        _cells[idx].mass = mass;
+        _cells[idx].mx = mass > 0 ? mx / mass : cx;
+        _cells[idx].my = mass > 0 ? my / mass : cy;
+        if (end - begin <= 1 || depth >= QUADTREE_MAX_DEPTH)
+            return idx;
+
+        auto first = _order.begin() + begin, last = _order.begin() + end;
+        auto midY = std::partition(first, last, [&](size_t p) { return _py[p] < cy; });
+        auto q1 = std::partition(first, midY, [&](size_t p) { return _px[p] < cx; });
+        auto q3 = std::partition(midY, last, [&](size_t p) { return _px[p] < cx; });
+        size_t bounds[5] = {begin, size_t(q1 - _order.begin()), size_t(midY - _order.begin()), size_t(q3 - _order.begin()), end};
+        float h = 0.5f * half;
+        float offs[4][2] = {{-h, -h}, {h, -h}, {-h, h}, {h, h}};
+        for (int q = 0; q < 4; ++q) {
+            if (bounds[q] == bounds[q + 1])
+                continue;
+            int child = _build(cx + offs[q][0], cy + offs[q][1], h, bounds[q], bounds[q + 1], depth + 1);
+            _cells[idx].child[q] = child;
+        }
+        return idx;
+    }
+
+    Vector2 QuadTree::repulsion(size_t idx, float theta, float k2) const {
+        Vector2 f = {0, 0};
+        if (_cells.empty())
+            return f;
+        const float x = _px[idx], y = _py[idx];
+        auto push = [&](float ox, float oy, float mass) {
+            float dx = x - ox, dy = y - oy;
+            float d2 = std::max(dx * dx + dy * dy, 1.0f);
+            float s = k2 * mass / d2;
+            f.x += dx * s;
+            f.y += dy * s;
+        };
+        int stack[4 * QUADTREE_MAX_DEPTH + 4];
+        int top = 0;
+        stack[top++] = 0;
+        while (top) {
+            const Cell& c = _cells[stack[--top]];
+            bool leaf = c.child[0] < 0 && c.child[1] < 0 && c.child[2] < 0 && c.child[3] < 0;
+            if (leaf) {
+                for (size_t i = c.begin; i < c.end; ++i)
+                    if (_order[i] != idx)
+                        push(_px[_order[i]], _py[_order[i]], _mass[_order[i]]);
+                continue;
+            }
+            float dx = x - c.mx, dy = y - c.my;
+            float d2 = dx * dx + dy * dy;
+            bool inside = std::abs(x - c.cx) <= c.half && std::abs(y - c.cy) <= c.half;
+            if (!inside && 4.0f * c.half * c.half < theta * theta * d2) {
+                push(c.mx, c.my, c.mass);
+                continue;
+            }
+            for (int q = 0; q < 4; ++q)
+                if (c.child[q] >= 0)
+                    stack[top++] = c.child[q];
+        }
+        return f;
+    }
+
+}
\ No newline at end of file
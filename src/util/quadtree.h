@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "raylib.h"
+
+namespace mhg {
+
+    class QuadTree {
+        public:
+            void build(const float* px, const float* py, const float* mass, size_t n);
+            Vector2 repulsion(size_t idx, float theta, float k2) const;
+
+        private:
+            struct Cell {
+                float cx = 0, cy = 0, half = 0;
+                float mx = 0, my = 0, mass = 0;
+                int child[4] = {-1, -1, -1, -1};
+                size_t begin = 0, end = 0;
+            };
+
+            const float* _px = nullptr;
+            const float* _py = nullptr;
+            const float* _mass = nullptr;
+            std::vector<Cell> _cells;
+            std::vector<size_t> _order;
+
+            int _build(float cx, float cy, float half, size_t begin, size_t end, int depth);
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+namespace mhg {
+
+    class Rng {
+        public:
+            explicit Rng(uint64_t seed) : _state(seed) { }
+
+            static uint64_t mix(uint64_t h, uint64_t v) {
+                h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+                return _finalize(h);
+            }
+
+            uint64_t next() {
+                return _finalize(_state += 0x9e3779b97f4a7c15ull);
+            }
+
+            float nextFloat() {
+                return static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+            }
+
+        private:
+            uint64_t _state;
+
+            static uint64_t _finalize(uint64_t z) {
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                return z ^ (z >> 31);
+            }
+    };
+
+}
\ No newline at end of file
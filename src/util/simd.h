@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MHG_SSE2
+#endif
+
+namespace mhg::simd {
+
+#if defined(__AVX__)
+    struct vfloat { __m256 v; };
+    constexpr size_t WIDTH = 8;
+    inline vfloat load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    inline void store(float* p, vfloat a) { _mm256_storeu_ps(p, a.v); }
+    inline vfloat set1(float x) { return {_mm256_set1_ps(x)}; }
+    inline vfloat operator+(vfloat a, vfloat b) { return {_mm256_add_ps(a.v, b.v)}; }
+    inline vfloat operator-(vfloat a, vfloat b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    inline vfloat operator*(vfloat a, vfloat b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    inline vfloat operator/(vfloat a, vfloat b) { return {_mm256_div_ps(a.v, b.v)}; }
+    inline vfloat sqrt(vfloat a) { return {_mm256_sqrt_ps(a.v)}; }
+    inline float hsum(vfloat a) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+#elif defined(MHG_SSE2)
+    struct vfloat { __m128 v; };
+    constexpr size_t WIDTH = 4;
+    inline vfloat load(const float* p) { return {_mm_loadu_ps(p)}; }
+    inline void store(float* p, vfloat a) { _mm_storeu_ps(p, a.v); }
+    inline vfloat set1(float x) { return {_mm_set1_ps(x)}; }
+    inline vfloat operator+(vfloat a, vfloat b) { return {_mm_add_ps(a.v, b.v)}; }
+    inline vfloat operator-(vfloat a, vfloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+    inline vfloat operator*(vfloat a, vfloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+    inline vfloat operator/(vfloat a, vfloat b) { return {_mm_div_ps(a.v, b.v)}; }
+    inline vfloat sqrt(vfloat a) { return {_mm_sqrt_ps(a.v)}; }
+    inline float hsum(vfloat a) {
+        __m128 s = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+#else
+    struct vfloat { float v; };
+    constexpr size_t WIDTH = 1;
+    inline vfloat load(const float* p) { return {*p}; }
+    inline void store(float* p, vfloat a) { *p = a.v; }
+    inline vfloat set1(float x) { return {x}; }
+    inline vfloat operator+(vfloat a, vfloat b) { return {a.v + b.v}; }
+    inline vfloat operator-(vfloat a, vfloat b) { return {a.v - b.v}; }
+    inline vfloat operator*(vfloat a, vfloat b) { return {a.v * b.v}; }
+    inline vfloat operator/(vfloat a, vfloat b) { return {a.v / b.v}; }
+    inline vfloat sqrt(vfloat a) { return {std::sqrt(a.v)}; }
+    inline float hsum(vfloat a) { return a.v; }
+#endif
+
+    inline void operator+=(vfloat& a, vfloat b) { a = a + b; }
+
+}
\ No newline at end of file
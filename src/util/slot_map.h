@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace mhg {
+
+    // Values stay contiguous in a dense array, with a flat key -> position table for lookups.
+    // Insertion appends and erasure moves the last value into the hole, so both are O(1) and
+    // iteration order is insertion order disturbed by erasures, not key order.
+    template<typename T>
+    class SlotMap {
+        public:
+            struct Handle {
+                size_t key = SIZE_MAX;
+                uint32_t gen = 0;
+            };
+
+            using value_type = std::pair<size_t, T>;
+            using iterator = typename std::vector<value_type>::iterator;
+            using const_iterator = typename std::vector<value_type>::const_iterator;
+            using reverse_iterator = typename std::vector<value_type>::reverse_iterator;
+
+            iterator begin() { return _items.begin(); }
+            iterator end() { return _items.end(); }
+            const_iterator begin() const { return _items.begin(); }
+            const_iterator end() const { return _items.end(); }
+            reverse_iterator rbegin() { return _items.rbegin(); }
+            reverse_iterator rend() { return _items.rend(); }
+
+            size_t size() const { return _items.size(); }
+            bool empty() const { return _items.empty(); }
+            size_t count(size_t key) const { return (key < _pos.size() && _pos[key]) ? 1 : 0; }
+            size_t position(size_t key) const { return _pos[key] - 1; }
+
+            iterator find(size_t key) {
+                return count(key) ? _items.begin() + position(key) : _items.end();
+            }
+
+            T& at(size_t key) {
+                if (!count(key))
+                    throw std::out_of_range("SlotMap::at");
+                return _items[position(key)].second;
+            }
+
+            T& operator[](size_t key) {
+                if (count(key))
+                    return _items[position(key)].second;
+                if (key >= _pos.size()) {
+                    _pos.resize(key + 1, 0);
+                    _gen.resize(key + 1, 0);
+                }
+                _items.push_back(value_type{key, T{}});
+                _pos[key] = uint32_t(_items.size());
+                return _items.back().second;
+            }
+
+            // An unused key, recycling erased ones before growing the key range. Erasure already
+            // bumped the generation, so handles to the previous holder stay dead.
+            size_t nextKey() {
+                while (!_free.empty()) {
+                    if (!count(_free.back()))
+                        return _free.back();
+                    _free.pop_back();
+                }
+                return _pos.size();
+            }
+
+            size_t erase(size_t key) {
+                if (!count(key))
+                    return 0;
+                size_t p = position(key);
+                if (p + 1 != _items.size()) {
+                    _items[p] = std::move(_items.back());
+                    _pos[_items[p].first] = uint32_t(p + 1);
+                }
+                _items.pop_back();
+                _pos[key] = 0;
+                _gen[key]++;
+                _free.push_back(key);
+                return 1;
+            }
+
+            void clear() {
+                for (auto& item : _items) {
+                    _pos[item.first] = 0;
+                    _gen[item.first]++;
+                    _free.push_back(item.first);
+                }
+                _items.clear();
+            }
+
+            Handle handle(size_t key) const {
+                return count(key) ? Handle{key, _gen[key]} : Handle{};
+            }
+
+            T get(Handle h) const {
+                return (count(h.key) && _gen[h.key] == h.gen) ? _items[position(h.key)].second : T{};
+            }
+
+        private:
+            std::vector<value_type> _items;
+            std::vector<uint32_t> _pos;
+            std::vector<uint32_t> _gen;
+            std::vector<size_t> _free;
+    };
+
+}
\ No newline at end of file
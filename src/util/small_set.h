@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace mhg {
+
+    // Sorted set with the first N elements stored inline; larger sets move to the heap.
+    // Iterators are plain pointers and are invalidated by insert and erase.
+    template<typename T, size_t N, typename Compare = std::less<T>>
+    class SmallSet {
+        public:
+            using value_type = T;
+            using iterator = T*;
+            using const_iterator = const T*;
+
+            SmallSet() = default;
+            SmallSet(std::initializer_list<T> items) {
+                for (auto& item : items)
+                    insert(item);
+            }
+
+            iterator begin() { return _data(); }
+            iterator end() { return _data() + _size; }
+            const_iterator begin() const { return _data(); }
+            const_iterator end() const { return _data() + _size; }
+
+            size_t size() const { return _size; }
+            bool empty() const { return !_size; }
+
+            iterator find(const T& value) {
+                auto it = std::lower_bound(begin(), end(), value, Compare());
+                return (it != end() && !Compare()(value, *it)) ? it : end();
+            }
+
+            size_t count(const T& value) { return find(value) != end(); }
+
+            std::pair<iterator, bool> insert(const T& value) {
+                auto it = std::lower_bound(begin(), end(), value, Compare());
+                if (it != end() && !Compare()(value, *it))
+                    return {it, false};
+                size_t p = it - begin();
+                if (_size < N) {
+                    std::move_backward(_inline.begin() + p, _inline.begin() + _size, _inline.begin() + _size + 1);
+                    _inline[p] = value;
+                } else {
+                    if (_size == N) {
+                        _heap.reserve(2 * N);
+                        _heap.assign(std::make_move_iterator(_inline.begin()), std::make_move_iterator(_inline.end()));
+                        _inline.fill(T());
+                    }
+                    _heap.insert(_heap.begin() + p, value);
+                }
+                _size++;
+                return {begin() + p, true};
+            }
+
+            size_t erase(const T& value) {
+                auto it = find(value);
+                if (it == end())
+                    return 0;
+                erase(it);
+                return 1;
+            }
+
+            iterator erase(iterator it) {
+                size_t p = it - begin();
+                if (_size > N) {
+                    _heap.erase(_heap.begin() + p);
+                    if (_heap.size() == N) {
+                        std::move(_heap.begin(), _heap.end(), _inline.begin());
+                        std::vector<T>().swap(_heap);
+                    }
+                } else {
+                    std::move(_inline.begin() + p + 1, _inline.begin() + _size, _inline.begin() + p);
+                    _inline[_size - 1] = T();
+                }
+                _size--;
+                return begin() + p;
+            }
+
+            void clear() {
+                _inline.fill(T());
+                std::vector<T>().swap(_heap);
+                _size = 0;
+            }
+
+        private:
+            std::array<T, N> _inline;
+            std::vector<T> _heap;
+            size_t _size = 0;
+
+            T* _data() { return (_size > N) ? _heap.data() : _inline.data(); }
+            const T* _data() const { return (_size > N) ? _heap.data() : _inline.data(); }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "spatial_grid.h"
+
+namespace mhg {
+
+    void SpatialGrid::clear() {
+        _cols = _rows = 0;
+        _start.clear();
+        _items.clear();
+    }
+
+    void SpatialGrid::build(const std::vector<Vector2>& points, float cell) {
+        clear();
+        size_t n = 0;
+        float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+        for (auto& p : points) {
+            if (!std::isfinite(p.x) || !std::isfinite(p.y))
+                continue;
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+            n++;
+        }
+        if (!n)
+            return;
+
+        // Keep the cell count around the point count however spread out or thin the set is.
+        float w = maxX - minX, h = maxY - minY;
+        cell = std::max({cell, std::sqrt(w * h / n), std::max(w, h) / n, 1e-3f});
+        _minX = minX;
+        _minY = minY;
+        _inv = 1.0f / cell;
+        _cols = std::min(size_t(w * _inv), n) + 1;
+        _rows = std::min(size_t(h * _inv), n) + 1;
+
+        // Counting sort by cell, so indices stay ascending within each cell.
+        auto cellOf = [&](const Vector2& p) {
+            size_t cx = std::min(size_t((p.x - _minX) * _inv), _cols - 1);
+            size_t cy = std::min(size_t((p.y - _minY) * _inv), _rows - 1);
+            return cy * _cols + cx;
+        };
+        _start.assign(_cols * _rows + 1, 0);
+        for (auto& p : points)
+            if (std::isfinite(p.x) && std::isfinite(p.y))
+                _start[cellOf(p) + 1]++;
+        for (size_t c = 1; c < _start.size(); ++c)
+            _start[c] += _start[c - 1];
+        _items.resize(n);
+        std::vector<size_t> fill(_start.begin(), _start.end() - 1);
+        for (size_t i = 0; i < points.size(); ++i)
+            if (std::isfinite(points[i].x) && std::isfinite(points[i].y))
+                _items[fill[cellOf(points[i])]++] = i;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "raylib.h"
+
+namespace mhg {
+
+    // Uniform bucket grid over a point set. Every finite point lands in exactly one cell; queries
+    // visit the indices of points in the cells a rectangle touches.
+    class SpatialGrid {
+        public:
+            void build(const std::vector<Vector2>& points, float cell);
+            void clear();
+
+            template<typename F>
+            void visit(Rectangle rect, F&& f) const {
+                if (!_cols || !(rect.width >= 0) || !(rect.height >= 0))
+                    return;
+                float x0 = (rect.x - _minX) * _inv, x1 = (rect.x + rect.width - _minX) * _inv;
+                float y0 = (rect.y - _minY) * _inv, y1 = (rect.y + rect.height - _minY) * _inv;
+                if (!(x1 >= 0 && y1 >= 0 && x0 < _cols && y0 < _rows))
+                    return;
+                size_t cx0 = size_t(std::max(x0, 0.0f)), cx1 = size_t(std::min(x1, float(_cols - 1)));
+                size_t cy0 = size_t(std::max(y0, 0.0f)), cy1 = size_t(std::min(y1, float(_rows - 1)));
+                for (size_t cy = cy0; cy <= cy1; ++cy) {
+                    size_t row = cy * _cols;
+                    for (size_t i = _start[row + cx0]; i < _start[row + cx1 + 1]; ++i)
+                        f(_items[i]);
+                }
+            }
+
+        private:
+            float _minX = 0, _minY = 0, _inv = 1;
+            size_t _cols = 0, _rows = 0;
+            std::vector<size_t> _start;
+            std::vector<size_t> _items;
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "../types/hypergraph.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <chrono>
+#include <vector>
+
+using namespace mhg::simd;
+
+namespace {
+
+    // Every node moves to the weighted average of where each other node would like it to be,
+    // computed from the previous iteration's positions, so rows are independent.
+    float majorize(size_t i, size_t N, const float* w, const float* l, float ws, const float* px, const float* py, float& nx, float& ny) {
+        if (ws == 0.0f) {
+            nx = px[i];
+            ny = py[i];
+            return 0.0f;
+        }
+        const vfloat pix = set1(px[i]), piy = set1(py[i]), eps = set1(1e-6f);
+        vfloat sx = set1(0.0f), sy = set1(0.0f), st = set1(0.0f);
+        size_t j = 0;
+        for (; j + WIDTH <= N; j += WIDTH) {
+            vfloat pjx = load(&px[j]), pjy = load(&py[j]);
+            vfloat dx = pix - pjx, dy = piy - pjy;
+            vfloat d = mhg::simd::sqrt(dx * dx + dy * dy + eps);
+            vfloat ww = load(w + j), ll = load(l + j);
+            vfloat r = ll / d;
+            sx += ww * (pjx + r * dx);
+            sy += ww * (pjy + r * dy);
+            st += ww * (d - ll) * (d - ll);
+        }
+        float sxs = hsum(sx), sys = hsum(sy), sts = hsum(st);
+        for (; j < N; ++j) {
+            const float dx = px[i] - px[j], dy = py[i] - py[j];
+            const float d = std::sqrt(dx * dx + dy * dy + 1e-6f);
+            const float r = l[j] / d;
+            sxs += w[j] * (px[j] + r * dx);
+            sys += w[j] * (py[j] + r * dy);
+            sts += w[j] * (d - l[j]) * (d - l[j]);
+        }
+        nx = sxs / ws;
+        ny = sys / ws;
+        return sts;
+    }
+
+    mhg::Matrix stressWeights(const mhg::Matrix& D) {
+        return D.unaryExpr([](float d) { return (d > 0.0f && d < 1e8f) ? 1.0f / (d * d) : 0.0f; });
+    }
+
+}
+
+mhg::LayoutStats mhg::HyperGraph::stressMajorization() {
+    auto start = std::chrono::steady_clock::now();
+    size_t N = _nodes.size();
+    std::vector<NodePtr> nodes;
+    nodes.reserve(N);
+    for (auto& n : _nodes)
+        nodes.push_back(n.second);
+    std::vector<float> px(N), py(N), nx(N), ny(N), rowStress(N);
+    for (size_t i = 0; i < N; ++i) {
+        px[i] = nodes[i]->pos().x;
+        py[i] = nodes[i]->pos().y;
+    }
+
+    const mhg::Matrix& D = distances();
+    mhg::Matrix L = SPRING_LEN * D;
+    mhg::Matrix W = stressWeights(D);
+    mhg::Vector Ws = W.colwise().sum();
+
+    auto majorizeRow = [&](size_t i) {
+        rowStress[i] = majorize(i, N, W.col(i).data(), L.col(i).data(), Ws(i), px.data(), py.data(), nx[i], ny[i]);
+    };
+
+    float prevStress = 0.0f;
+    int its = 0;
+    while (its < STRESS_MAX_ITS) {
+        if (N >= LAYOUT_PARALLEL_MIN_NODES)
+            parallelFor(N, majorizeRow, 16);
+        else
+            for (size_t i = 0; i < N; ++i)
+                majorizeRow(i);
+        px.swap(nx);
+        py.swap(ny);
+        float stress = 0.0f;
+        for (auto s : rowStress)
+            stress += s;
+        bool converged = its && prevStress - stress <= STRESS_EPS * prevStress;
+        prevStress = stress;
+        its++;
+        if (converged)
+            break;
+    }
+
+    for (size_t i = 0; i < N; ++i)
+        nodes[i]->pos() = {px[i], py[i]};
+
+    return LayoutStats{its, prevStress, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+}
+
+void mhg::HyperGraph::relayout() {
+    _placeNewNodes();
+    if (_dirtyNodes.empty())
+        return;
+    size_t N = _nodes.size();
+    std::vector<NodePtr> nodes;
+    nodes.reserve(N);
+    std::vector<size_t> active;
+    std::vector<int> hop(N, -1);
+    for (auto& n : _nodes) {
+        if (_dirtyNodes.count(n.first)) {
+            hop[nodes.size()] = 0;
+            active.push_back(nodes.size());
+        }
+        nodes.push_back(n.second);
+    }
+    _dirtyNodes.clear();
+
+    const auto& adj = adjacency();
+    const auto& offsets = adj.offsets;
+    const auto& targets = adj.targets;
+    for (size_t h = 0; h < active.size(); ++h) {
+        size_t u = active[h];
+        if (hop[u] == RELAYOUT_HOPS)
+            continue;
+        for (size_t k = offsets[u]; k < offsets[u + 1]; ++k)
+            if (hop[targets[k]] < 0) {
+                hop[targets[k]] = hop[u] + 1;
+                active.push_back(targets[k]);
+            }
+    }
+    size_t A = active.size();
+
+    mhg::Matrix D;
+    if (N <= DENSE_LAYOUT_MAX_NODES) {
+        const mhg::Matrix& full = distances();
+        D.resize(N, A);
+        for (size_t c = 0; c < A; ++c)
+            D.col(c) = full.col(active[c]);
+    } else {
+        bfsDistances(D, active);
+    }
+    mhg::Matrix L = SPRING_LEN * D;
+    mhg::Matrix W = stressWeights(D);
+    mhg::Vector Ws = W.colwise().sum();
+
+    std::vector<float> px(N), py(N), nx(A), ny(A), rowStress(A);
+    for (size_t i = 0; i < N; ++i) {
+        px[i] = nodes[i]->pos().x;
+        py[i] = nodes[i]->pos().y;
+    }
+    auto majorizeRow = [&](size_t c) {
+        rowStress[c] = majorize(active[c], N, W.col(c).data(), L.col(c).data(), Ws(c), px.data(), py.data(), nx[c], ny[c]);
+    };
+
+    // Only the neighbourhood of the edit moves; everything else is held in place.
+    float prevStress = 0.0f;
+    for (int its = 0; its < RELAYOUT_MAX_ITS; ++its) {
+        if (A * N >= LAYOUT_PARALLEL_MIN_NODES * LAYOUT_PARALLEL_MIN_NODES)
+            parallelFor(A, majorizeRow, 16);
+        else
+            for (size_t c = 0; c < A; ++c)
+                majorizeRow(c);
+        float stress = 0.0f;
+        for (size_t c = 0; c < A; ++c) {
+            px[active[c]] = nx[c];
+            py[active[c]] = ny[c];
+            stress += rowStress[c];
+        }
+        if (its && prevStress - stress <= STRESS_EPS * prevStress)
+            break;
+        prevStress = stress;
+    }
+
+    for (size_t c = 0; c < A; ++c)
+        nodes[active[c]]->pos() = {px[active[c]], py[active[c]]};
+    for (auto& e : _edges)
+        e.second->reposition();
+}
\ No newline at end of file
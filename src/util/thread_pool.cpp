@@ -0,0 +1,107 @@
+#include "thread_pool.h"
+#include "parallel.h"
+
+namespace mhg {
+
+    namespace {
+        thread_local const ThreadPool* tlsPool = nullptr;
+        thread_local size_t tlsWorker = 0;
+    }
+
+    ThreadPool::ThreadPool(size_t nThreads) {
+        for (size_t i = 0; i < nThreads; ++i)
+            _queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 0; i < nThreads; ++i) {
+            _workers.emplace_back([this, i]() {
+                tlsPool = this;
+                tlsWorker = i;
+                while (true) {
+                    std::function<void()> task;
+                    if (_take(task)) {
+                        task();
+                        continue;
+                    }
+                    std::unique_lock<std::mutex> lock(_lock);
+                    _cv.wait(lock, [this]() { return _stopping || _pending.load() > 0; });
+                    if (_stopping && !_pending.load())
+                        return;
+                }
+            });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _stopping = true;
+        }
+        _cv.notify_all();
+        for (auto& w : _workers)
+            w.join();
+    }
+
+    void ThreadPool::submit(std::function<void()> task) {
+        if (_workers.empty()) {
+            task();
+            return;
+        }
+        size_t self = _self();
+        size_t q = (self < _queues.size()) ? self : (_next.fetch_add(1) % _queues.size());
+        {
+            std::lock_guard<std::mutex> lock(_queues[q]->lock);
+            _queues[q]->tasks.push_back(std::move(task));
+        }
+        _pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+        }
+        _cv.notify_one();
+    }
+
+    bool ThreadPool::runPending() {
+        std::function<void()> task;
+        if (!_take(task))
+            return false;
+        task();
+        return true;
+    }
+
+    size_t ThreadPool::_self() const {
+        return (tlsPool == this) ? tlsWorker : _queues.size();
+    }
+
+    bool ThreadPool::_pop(size_t q, bool back, std::function<void()>& task) {
+        std::lock_guard<std::mutex> lock(_queues[q]->lock);
+        auto& tasks = _queues[q]->tasks;
+        if (tasks.empty())
+            return false;
+        if (back) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        _pending.fetch_sub(1);
+        return true;
+    }
+
+    bool ThreadPool::_take(std::function<void()>& task) {
+        if (!_pending.load() || _queues.empty())
+            return false;
+        size_t self = _self();
+        if (self < _queues.size() && _pop(self, true, task))
+            return true;
+        size_t start = (self < _queues.size()) ? self + 1 : _next.load();
+        for (size_t k = 0; k < _queues.size(); ++k)
+            if (_pop((start + k) % _queues.size(), false, task))
+                return true;
+        return false;
+    }
+
+    ThreadPool& ThreadPool::shared() {
+        static ThreadPool pool(hardwareThreads() - 1);
+        return pool;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mhg {
+
+    class ThreadPool {
+        public:
+            explicit ThreadPool(size_t nThreads);
+            ~ThreadPool();
+
+            size_t size() const { return _workers.size(); }
+            void submit(std::function<void()> task);
+            bool runPending();
+
+            static ThreadPool& shared();
+
+        private:
+            struct Queue {
+                std::mutex lock;
+                std::deque<std::function<void()>> tasks;
+            };
+
+            std::vector<std::thread> _workers;
+            std::vector<std::unique_ptr<Queue>> _queues;
+            std::atomic<size_t> _pending = 0;
+            std::atomic<size_t> _next = 0;
+            std::mutex _lock;
+            std::condition_variable _cv;
+            bool _stopping = false;
+
+            size_t _self() const;
+            bool _pop(size_t q, bool back, std::function<void()>& task);
+            bool _take(std::function<void()>& task);
+    };
+
+}
\ No newline at end of file
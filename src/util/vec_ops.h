@@ -74,4 +74,13 @@ inline std::ostream& operator<<(std::ostream& os, const Vector3& v) {
 
 inline bool operator== (const Vector3& v1, const Vector3& v2) {
     return v1.x == v2.x && v1.y == v2.y && v1.z == v2.z;
+}
+
+// Whether a screen-space box overlaps the window; anything that does not is culled from drawing.
+inline bool isOnScreen(Vector2 min, Vector2 max) {
+    return max.x >= 0 && max.y >= 0 && min.x <= GetScreenWidth() && min.y <= GetScreenHeight();
+}
+
+inline bool isOnScreen(Vector2 c, float r) {
+    return isOnScreen(Vector2{c.x - r, c.y - r}, Vector2{c.x + r, c.y + r});
 }
\ No newline at end of file